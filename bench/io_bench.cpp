@@ -0,0 +1,118 @@
+// Buffered I/O benchmark: a print-heavy program run by the interpreter under
+// each flush policy of the runtime's I/O layer, writing to the real standard
+// output (the line policy makes one write per print, as std::endl did), and
+// a program reading every line of a large input through the layer's bulk
+// buffer, against std::getline on the synchronized std::cin.
+//
+//   g++ -std=c++17 -O2 bench/io_bench.cpp src/lexer.cpp src/scan.cpp src/symbols.cpp src/arena.cpp src/parser.cpp src/flatast.cpp src/semantic.cpp src/bytecode.cpp src/value.cpp src/interpreter.cpp runtime/runtime.c -Iinclude -Iruntime -o io_bench
+//   ./io_bench [lines] > output      (the timings go to stderr)
+
+#include "context.h"
+#include "parser.h"
+#include "semantic.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "runtime.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the default sink, counting its writes
+static size_t writes = 0;
+static void countedWrite(const char* text, int64_t length, void*) {
+    ++writes;
+    while (length > 0) {
+        ssize_t n = write(1, text, static_cast<size_t>(length));
+        if (n <= 0) return;
+        text += n;
+        length -= n;
+    }
+}
+
+struct Program {
+    CompileContext ctx;
+    Bytecode bc;
+
+    explicit Program(const std::string& src) {
+        Lexer lexer(src, ctx.symbols);
+        Parser parser(lexer, ctx.arena);
+        FlatAST flat = parser.parseFlat();
+        bc = compileBytecode(flat, ctx.symbols, SemanticAnalyzer(ctx.symbols).resolve(flat));
+    }
+    double run() {
+        auto t0 = std::chrono::steady_clock::now();
+        Interpreter(ctx.symbols).execute(bc);
+        return seconds(t0);
+    }
+};
+
+// point file descriptor 0 at `path`, from its start
+static void inputFrom(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    dup2(fd, 0);
+    close(fd);
+    std::clearerr(stdin);
+    std::cin.clear();
+    rt_set_input(nullptr, nullptr);
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    // ints and strings, one print per line
+    std::string prints = "x = 0;\n";
+    for (size_t i = 0; i < n / 2; ++i) prints += "x = x + 1;\ncout(x);\ncout(\"line \" + x);\n";
+    Program printing(prints);
+
+    rt_set_output(countedWrite, nullptr);
+    const struct {
+        const char* label;
+        int policy;
+    } POLICIES[] = {{"line  ", RT_FLUSH_LINE}, {"64 KiB", RT_FLUSH_SIZE}, {"exit  ", RT_FLUSH_EXIT}};
+    for (const auto& p : POLICIES) {
+        rt_set_flush(p.policy, RT_FLUSH_THRESHOLD);
+        writes = 0;
+        double t = printing.run();
+        std::cerr << "print, flush " << p.label << ": " << n << " lines, " << writes << " writes, " << t * 1e3
+                  << " ms\n";
+    }
+    rt_set_output(nullptr, nullptr);
+
+    // one line of input per cin
+    fs::path path = fs::temp_directory_path() / "mini-io-bench-input";
+    {
+        std::ofstream input(path);
+        for (size_t i = 0; i < n; ++i) input << i << "\n";
+    }
+    std::string reads = "t = 0;\n";
+    for (size_t i = 0; i < n; ++i) reads += "cin(x);\nt = t + x;\n";
+    reads += "cout(t);\n";
+    Program reading(reads);
+
+    inputFrom(path.string());
+    auto t0 = std::chrono::steady_clock::now();
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(std::cin, line)) ++lines;
+    double getline = seconds(t0);
+
+    inputFrom(path.string());
+    double bulk = reading.run();
+    std::cerr << "read: " << lines << " lines; std::getline on std::cin " << getline * 1e3
+              << " ms, interpreter reading them through the bulk buffer (and adding) " << bulk * 1e3 << " ms ("
+              << getline / bulk << "x)\n";
+    fs::remove(path);
+    return 0;
+}
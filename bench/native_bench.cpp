@@ -0,0 +1,163 @@
+// Native-code benchmark: compiles long arithmetic programs to x86-64 with
+// the system toolchain and compares running the executable (process start
+// included) with Interpreter::execute on the same AST, and with the JIT
+// (encoding included). All read the same input and their outputs are
+// compared.
+//
+//   g++ -std=c++17 -O2 bench/native_bench.cpp src/lexer.cpp src/scan.cpp src/symbols.cpp src/arena.cpp src/parser.cpp src/flatast.cpp src/semantic.cpp src/ir.cpp src/bytecode.cpp src/value.cpp src/interpreter.cpp src/ssa.cpp src/passes.cpp src/gvn.cpp src/optimizer.cpp src/regalloc.cpp src/x86.cpp src/jit.cpp runtime/runtime.c -Iinclude -Iruntime -o native_bench
+//   ./native_bench [statements] [runtime/runtime.c]
+
+#include "context.h"
+#include "parser.h"
+#include "semantic.h"
+#include "ir.h"
+#include "interpreter.h"
+#include "optimizer.h"
+#include "x86.h"
+#include "jit.h"
+#include "runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Program input served from memory, and output collected there
+struct MemoryInput {
+    const std::string& text;
+    size_t at = 0;
+};
+static int64_t serve(char* buffer, int64_t capacity, void* context) {
+    MemoryInput& in = *static_cast<MemoryInput*>(context);
+    size_t n = std::min(static_cast<size_t>(capacity), in.text.size() - in.at);
+    std::memcpy(buffer, in.text.data() + in.at, n);
+    in.at += n;
+    return static_cast<int64_t>(n);
+}
+static void collect(const char* text, int64_t length, void* out) {
+    static_cast<std::string*>(out)->append(text, static_cast<size_t>(length));
+}
+
+static void run(const char* label, const std::string& src, const std::string& input, const std::string& runtime) {
+    CompileContext ctx;
+    Lexer lexer(src, ctx.symbols);
+    Parser parser(lexer, ctx.arena);
+    std::vector<ASTNode*> ast = parser.parse();
+    SemanticAnalyzer semantic(ctx.symbols);
+    semantic.analyze(ast);
+    IRGenerator irgen(ctx.symbols);
+    Optimizer opt;
+    IRProgram ir = opt.optimize(irgen.generate(ast));
+
+    // interpreter, with the runtime's input and output in memory
+    MemoryInput source{input};
+    std::string interpreted;
+    rt_set_input(serve, &source);
+    rt_set_output(collect, &interpreted);
+    auto t0 = std::chrono::steady_clock::now();
+    Interpreter interpreter(ctx.symbols);
+    interpreter.execute(ast);
+    double interpret = seconds(t0);
+    rt_set_output(nullptr, nullptr);
+    rt_set_input(nullptr, nullptr);
+
+    fs::path dir = fs::temp_directory_path() / "mini-native-bench";
+    fs::create_directories(dir);
+    std::string exe = (dir / "program").string();
+    std::string inFile = (dir / "input").string(), outFile = (dir / "output").string();
+    std::ofstream(inFile) << input;
+
+    t0 = std::chrono::steady_clock::now();
+    X86CodeGenerator x86;
+    std::string assembly = x86.generate(ir, ctx.symbols);
+    double generate = seconds(t0);
+    t0 = std::chrono::steady_clock::now();
+    std::string error;
+    if (!buildExecutable(assembly, runtime, exe, error)) {
+        std::cerr << error << "\n";
+        std::exit(1);
+    }
+    double build = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    int status = std::system((exe + " < " + inFile + " > " + outFile).c_str());
+    double native = seconds(t0);
+    std::stringstream produced;
+    produced << std::ifstream(outFile).rdbuf();
+    bool same = status == 0 && produced.str() == interpreted;
+
+    // the JIT runs in this process: point stdin and stdout at the files
+    std::string jitFile = (dir / "jit-output").string();
+    std::fflush(stdout);
+    int savedIn = dup(0), savedOut = dup(1);
+    dup2(open(inFile.c_str(), O_RDONLY), 0);
+    dup2(open(jitFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644), 1);
+    t0 = std::chrono::steady_clock::now();
+    JitProgram jit;
+    bool compiled = jit.compile(ir, ctx.symbols, error);
+    double encode = seconds(t0);
+    t0 = std::chrono::steady_clock::now();
+    jit.run();
+    std::fflush(stdout);
+    double jitted = seconds(t0);
+    dup2(savedIn, 0);
+    dup2(savedOut, 1);
+    std::stringstream jitProduced;
+    jitProduced << std::ifstream(jitFile).rdbuf();
+    same = same && compiled && jitProduced.str() == interpreted;
+
+    std::cout << label << ": " << ir.code.size() << " instructions, " << x86.allocationStats().spilled
+              << " spilled; codegen " << generate * 1e3 << " ms, as+ld " << build * 1e3 << " ms; interpreter "
+              << interpret * 1e3 << " ms, native " << native * 1e3 << " ms (" << interpret / native << "x), jit "
+              << encode * 1e3 << " + " << jitted * 1e3 << " ms (" << interpret / (encode + jitted) << "x)"
+              << (same ? "" : "  OUTPUT DIFFERS") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::string runtime = argc > 2 ? argv[2] : "runtime/runtime.c";
+
+    // a recurrence over a few variables, seeded from input so nothing folds
+    std::string chain = "cin(a);\ncin(b);\nx = a;\ny = b;\n";
+    for (size_t i = 0; i < n; ++i) {
+        switch (i % 4) {
+            case 0: chain += "x = x * 3 + y - a;\n"; break;
+            case 1: chain += "y = (y + x / 7) * 2 - b;\n"; break;
+            case 2: chain += "z = x - y * 5 + (x + 1) / 3;\n"; break;
+            default: chain += "x = z / 2 + y - x * 3;\n"; break;
+        }
+        if (i % 1000 == 999) chain += "cout(x + y);\n";
+    }
+    run("recurrence", chain, "12\n34\n", runtime);
+
+    // wide expressions: many values alive at once
+    std::string wide = "cin(a);\nb = a + 1;\n";
+    for (size_t i = 0; i < n / 4; ++i) {
+        wide += "c = (a * 2 + b) * (a - b * 3) + (a / 5 - b) * (b + 7 - a * a) + ((a + 9) * (b - 4) - (a * b + 11)) * 3;\n";
+        wide += "a = b - c / 9;\nb = c + a / 7;\n";
+        if (i % 1000 == 999) wide += "cout(c);\n";
+    }
+    run("wide      ", wide, "5\n", runtime);
+
+    // strings mixed in: concatenation and numeric strings go to the runtime
+    std::string mixed = "cin(s);\nn = 1;\n";
+    for (size_t i = 0; i < n / 2; ++i) {
+        mixed += "n = n * 3 + s - n / 2;\n";
+        if (i % 1000 == 999) mixed += "cout(\"n = \" + n);\n";
+    }
+    run("mixed     ", mixed, "7\n", runtime);
+    return 0;
+}
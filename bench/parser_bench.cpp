@@ -0,0 +1,102 @@
+// Deep-expression benchmark: parses, analyzes, lowers to IR and interprets
+// expressions that used to overflow the native stack (thousands of nested
+// parens, long unary-minus chains) plus one very long flat expression and
+// many short statements, and prints the time per phase and per operator.
+// It also times the two ways to the flat layout (flatast.h): parsing to a
+// tree and copying it, and Parser::parseFlat().
+//
+//   g++ -std=c++17 -O2 bench/parser_bench.cpp src/lexer.cpp src/scan.cpp src/symbols.cpp src/arena.cpp src/parser.cpp src/flatast.cpp src/semantic.cpp src/ir.cpp src/bytecode.cpp src/value.cpp src/interpreter.cpp runtime/runtime.c -Iinclude -Iruntime -o parser_bench
+//   ./parser_bench [operators]
+
+#include "context.h"
+#include "parser.h"
+#include "flatast.h"
+#include "semantic.h"
+#include "ir.h"
+#include "interpreter.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run(const char* label, const std::string& src, size_t operators) {
+    CompileContext ctx;
+    auto t0 = std::chrono::steady_clock::now();
+    Lexer lexer(src, ctx.symbols);
+    Parser parser(lexer, ctx.arena);
+    std::vector<ASTNode*> ast = parser.parse();
+    double parse = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    SemanticAnalyzer semantic(ctx.symbols);
+    semantic.analyze(ast);
+    double sema = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    IRGenerator irgen(ctx.symbols);
+    size_t irSize = irgen.generate(ast).code.size();
+    double irTime = seconds(t0);
+
+    // the program only assigns, so the interpreter prints nothing
+    t0 = std::chrono::steady_clock::now();
+    Interpreter interpreter(ctx.symbols);
+    interpreter.execute(ast);
+    double exec = seconds(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    FlatAST copied = FlatAST::fromTree(ast);
+    double copy = seconds(t0);
+
+    CompileContext flatCtx;
+    t0 = std::chrono::steady_clock::now();
+    Lexer flatLexer(src, flatCtx.symbols);
+    Parser flatParser(flatLexer, flatCtx.arena);
+    FlatAST direct = flatParser.parseFlat();
+    double parseFlat = seconds(t0);
+
+    double total = parse + sema + irTime + exec;
+    std::cout << label << ": parse " << parse * 1e3 << " ms, semantic " << sema * 1e3
+              << " ms, IR " << irTime * 1e3 << " ms (" << irSize << " instructions), run "
+              << exec * 1e3 << " ms; " << total * 1e9 / static_cast<double>(operators)
+              << " ns/operator; flat AST: parse + copy " << (parse + copy) * 1e3 << " ms, parseFlat "
+              << parseFlat * 1e3 << " ms" << (copied.payload == direct.payload ? "" : "  FLAT AST DIFFERS") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // x = ((((...(1)...)) + 1) ...): n nested parenthesized additions
+    std::string nested = "x = ";
+    for (size_t i = 0; i < n; ++i) nested += '(';
+    nested += '1';
+    for (size_t i = 0; i < n; ++i) nested += " + 1)";
+    nested += ";\n";
+    run("nested parens", nested, n);
+
+    // x = - - - ... - 1;
+    std::string unary = "x = ";
+    for (size_t i = 0; i < n; ++i) unary += "- ";
+    unary += "1;\n";
+    run("unary chain  ", unary, n);
+
+    // x = 1 + 2 * 3 - 4 + ... : long flat expression with mixed precedence
+    std::string flat = "x = 1";
+    const char ops[] = {'+', '*', '-', '+'};
+    for (size_t i = 0; i < n; ++i) {
+        flat += ' ';
+        flat += ops[i % 4];
+        flat += " 2";
+    }
+    flat += ";\n";
+    run("flat         ", flat, n);
+
+    // x = x + 2 * 3; n / 4 times: a long script of short statements
+    std::string statements = "x = 1;\n";
+    for (size_t i = 0; i < n / 4; ++i) statements += "x = x + 2 * 3;\n";
+    run("statements   ", statements, n / 2);
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Bytecode VM benchmark: runs arithmetic-heavy programs with the bytecode
+// interpreter and with the string tree walk it replaced, kept below as the
+// baseline, and compares their output. Compiling to bytecode (flat AST and
+// slot resolution included) is timed on its own: these programs have no
+// loops, so every instruction runs exactly once.
+//
+//   g++ -std=c++17 -O2 bench/vm_bench.cpp src/lexer.cpp src/scan.cpp src/symbols.cpp src/arena.cpp src/parser.cpp src/flatast.cpp src/semantic.cpp src/bytecode.cpp src/value.cpp src/interpreter.cpp runtime/runtime.c -Iinclude -Iruntime -o vm_bench
+//   ./vm_bench [statements]
+
+#include "context.h"
+#include "parser.h"
+#include "semantic.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The previous interpreter: every value a std::string, every operand parsed
+// with std::stol, variables in a hash map. Its arithmetic is widened to the
+// 64-bit wrapping ints of today's so the two outputs still compare.
+class StringTreeWalker {
+private:
+    const SymbolTable& symbols;
+    std::unordered_map<Symbol, std::string> variables;
+
+    static bool tryParseInt(const std::string& s, int64_t& out) {
+        try {
+            size_t idx = 0;
+            long v = std::stol(s, &idx, 10);
+            if (idx != s.size()) return false;
+            out = v;
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    std::string binop(char op, const std::string& left, const std::string& right, int line) {
+        int64_t li = 0, ri = 0;
+        bool leftIsNum = tryParseInt(left, li);
+        bool rightIsNum = tryParseInt(right, ri);
+        uint64_t ul = static_cast<uint64_t>(li), ur = static_cast<uint64_t>(ri);
+        std::string at = " non-numeric values at line " + std::to_string(line);
+        switch (op) {
+            case '+':
+                if (leftIsNum && rightIsNum) return std::to_string(static_cast<int64_t>(ul + ur));
+                return left + right;
+            case '-':
+                if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot subtract" + at);
+                return std::to_string(static_cast<int64_t>(ul - ur));
+            case '*':
+                if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot multiply" + at);
+                return std::to_string(static_cast<int64_t>(ul * ur));
+            default:
+                if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot divide" + at);
+                if (ri == 0) throw std::runtime_error("Runtime error: Division by zero at line " + std::to_string(line));
+                return std::to_string(ri == -1 ? static_cast<int64_t>(0 - ul) : li / ri);
+        }
+    }
+
+    std::string eval(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Number: return std::to_string(node->number);
+            case NodeKind::String: return symbols.name(node->symbol);
+            case NodeKind::Variable: {
+                auto it = variables.find(node->symbol);
+                if (it == variables.end())
+                    throw std::runtime_error("Runtime error: Undefined variable '" + symbols.name(node->symbol) +
+                                             "' at line " + std::to_string(node->line));
+                return it->second;
+            }
+            case NodeKind::BinOp: {
+                std::string left = eval(node->left);
+                std::string right = eval(node->right);
+                return binop(node->op, left, right, node->line);
+            }
+            case NodeKind::Assign: return variables[node->symbol] = eval(node->left);
+            case NodeKind::Cin: {
+                std::string input;
+                if (!std::getline(std::cin, input)) input = "";
+                return variables[node->symbol] = input;
+            }
+            case NodeKind::Cout: {
+                std::string val = eval(node->left);
+                std::cout << val << std::endl;
+                return val;
+            }
+        }
+        return "";
+    }
+
+public:
+    explicit StringTreeWalker(const SymbolTable& symbols) : symbols(symbols) {}
+
+    void execute(const std::vector<ASTNode*>& nodes) {
+        for (auto node : nodes) {
+            if (!node) continue;
+            try {
+                eval(node);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+};
+
+// Program input served from memory, and output collected there, for the
+// runtime's buffered I/O that the interpreter uses.
+struct MemoryInput {
+    const std::string& text;
+    size_t at = 0;
+};
+static int64_t serve(char* buffer, int64_t capacity, void* context) {
+    MemoryInput& in = *static_cast<MemoryInput*>(context);
+    size_t n = std::min(static_cast<size_t>(capacity), in.text.size() - in.at);
+    std::memcpy(buffer, in.text.data() + in.at, n);
+    in.at += n;
+    return static_cast<int64_t>(n);
+}
+static void collect(const char* text, int64_t length, void* out) {
+    static_cast<std::string*>(out)->append(text, static_cast<size_t>(length));
+}
+
+// Run `execute` with cin and cout (and the runtime's I/O) redirected to
+// memory; returns the seconds it took and leaves the output in `out`.
+template <class Run>
+static double timed(const std::string& input, std::string& out, Run execute) {
+    std::istringstream in(input);
+    std::ostringstream captured;
+    std::streambuf* oldIn = std::cin.rdbuf(in.rdbuf());
+    std::streambuf* oldOut = std::cout.rdbuf(captured.rdbuf());
+    MemoryInput source{input};
+    std::string written;
+    rt_set_input(serve, &source);
+    rt_set_output(collect, &written);
+    auto t0 = std::chrono::steady_clock::now();
+    execute();
+    double elapsed = seconds(t0);
+    rt_set_output(nullptr, nullptr);
+    rt_set_input(nullptr, nullptr);
+    std::cin.rdbuf(oldIn);
+    std::cout.rdbuf(oldOut);
+    out = captured.str() + written;
+    return elapsed;
+}
+
+static void run(const char* label, const std::string& src, const std::string& input) {
+    CompileContext ctx;
+    Lexer lexer(src, ctx.symbols);
+    Parser parser(lexer, ctx.arena);
+    std::vector<ASTNode*> ast = parser.parse();
+
+    std::string walked, interpreted;
+    double walk = timed(input, walked, [&] { StringTreeWalker(ctx.symbols).execute(ast); });
+
+    auto t0 = std::chrono::steady_clock::now();
+    FlatAST flat = FlatAST::fromTree(ast);
+    Bytecode bc = compileBytecode(flat, ctx.symbols, SemanticAnalyzer(ctx.symbols).resolve(flat));
+    double compile = seconds(t0);
+    double vm = timed(input, interpreted, [&] { Interpreter(ctx.symbols).execute(bc); });
+
+    std::cout << label << ": " << bc.code.size() << " instructions, " << bc.registers << " registers; tree walk "
+              << walk * 1e3 << " ms, bytecode " << vm * 1e3 << " ms (" << walk / vm << "x) + compile "
+              << compile * 1e3 << " ms" << (walked == interpreted ? "" : "  OUTPUT DIFFERS") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    // a recurrence over a few variables, seeded from input
+    std::string chain = "cin(a);\ncin(b);\nx = a;\ny = b;\n";
+    for (size_t i = 0; i < n; ++i) {
+        switch (i % 4) {
+            case 0: chain += "x = x * 3 + y - a;\n"; break;
+            case 1: chain += "y = (y + x / 7) * 2 - b;\n"; break;
+            case 2: chain += "z = x - y * 5 + (x + 1) / 3;\n"; break;
+            default: chain += "x = z / 2 + y - x * 3;\n"; break;
+        }
+        if (i % 1000 == 999) chain += "cout(x + y);\n";
+    }
+    run("recurrence", chain, "12\n34\n");
+
+    // wide expressions: many temps alive at once
+    std::string wide = "cin(a);\nb = a + 1;\n";
+    for (size_t i = 0; i < n / 4; ++i) {
+        wide += "c = (a * 2 + b) * (a - b * 3) + (a / 5 - b) * (b + 7 - a * a) + ((a + 9) * (b - 4) - (a * b + 11)) * 3;\n";
+        wide += "a = b - c / 9;\nb = c + a / 7;\n";
+        if (i % 1000 == 999) wide += "cout(c);\n";
+    }
+    run("wide      ", wide, "5\n");
+
+    // strings mixed in: numeric strings and concatenation take the slow path
+    std::string mixed = "cin(s);\nn = 1;\n";
+    for (size_t i = 0; i < n / 2; ++i) {
+        mixed += "n = n * 3 + s - n / 2;\n";
+        if (i % 1000 == 999) mixed += "cout(\"n = \" + n);\n";
+    }
+    run("mixed     ", mixed, "7\n");
+    return 0;
+}
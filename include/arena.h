@@ -0,0 +1,64 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Bump-pointer allocator. Objects are carved out of large chunks and are
+// never freed individually: destroying (or reset()ing) the arena releases
+// everything at once. Chunk sizes grow geometrically, so a whole AST costs a
+// handful of frees no matter how many nodes it has. Only use it for
+// trivially destructible types - destructors are never run.
+class Arena {
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size; // usable bytes after the header
+    };
+
+    Chunk* head;
+    char* cur;
+    char* end;
+    size_t nextChunkSize;
+    size_t used;
+
+    void grow(size_t minBytes);
+
+public:
+    explicit Arena(size_t firstChunkSize = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        size_t misalign = reinterpret_cast<size_t>(cur) & (align - 1);
+        size_t pad = misalign ? align - misalign : 0;
+        if (static_cast<size_t>(end - cur) < size + pad) {
+            grow(size + align);
+            misalign = reinterpret_cast<size_t>(cur) & (align - 1);
+            pad = misalign ? align - misalign : 0;
+        }
+        char* p = cur + pad;
+        cur = p + size;
+        used += size + pad;
+        return p;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Free every chunk; all pointers handed out so far become invalid.
+    void reset();
+
+    // Take ownership of all of `other`'s chunks (e.g. an arena filled by a
+    // worker thread). `other` is left empty.
+    void adopt(Arena& other);
+
+    size_t bytesUsed() const { return used; }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "threadpool.h"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Batch mode: many source files compiled (and their programs run) on a
+// thread pool. Every phase object belongs to one file, so the only shared
+// state is the process's standard streams; each file writes into its own
+// capture instead, and the captures are written out in the order of the
+// file list - a file as soon as it and every file before it are done - so
+// the result is the same for any number of threads.
+
+// Compiles one file, writing what it would print on standard output and
+// standard error to `out` and `err`; nonzero means it failed.
+using BatchCompile = std::function<int(const std::string& file, std::ostream& out, std::ostream& err)>;
+
+struct BatchSummary {
+    size_t files = 0;
+    std::vector<std::string> failed; // in list order
+    double milliseconds = 0;
+};
+
+// The source files named by command-line inputs, in order: a directory
+// stands for the .txt files directly inside it, sorted by name, "@LIST"
+// for the inputs listed in the file LIST, one per line, and anything else
+// for itself. Directories and lists that cannot be read are reported to
+// `diag` and make the result false.
+bool collectSources(const std::vector<std::string>& inputs, std::vector<std::string>& files,
+                    std::ostream& diag = std::cerr);
+
+// Compile every file on `pool` and write each one's capture to `out` and
+// `err`. While `compile` runs, the runtime's output and errors (runtime.h,
+// on that thread) go to the capture, and a program reads FILE.in next to
+// its source FILE.txt, or an empty input - never the shared standard input.
+BatchSummary compileBatch(const std::vector<std::string>& files, ThreadPool& pool, const BatchCompile& compile,
+                          std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+#endif
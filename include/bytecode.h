@@ -0,0 +1,67 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "flatast.h"
+#include "ir.h"
+#include "semantic.h"
+#include "value.h"
+#include <cstdint>
+#include <vector>
+
+// Bytecode operations. Operands a, b, c, d are register numbers unless
+// noted; arithmetic writes a only once it succeeded.
+//
+//   Move   a = b                    Check  fail if a was never assigned
+//   Add..  a = b op c               AddK.. a = b op (int)c, c an immediate
+//   AddAdd.. a = (b op1 c) op2 d    (superinstructions for a chain of two)
+//   Concat a = b + c, an operand proved never to be a number
+//   Print  cout(a)                  Read   cin(a)
+//   Halt   end of the program
+#define BYTECODE_OPS(X)                                                                 \
+    X(Move) X(Check) X(Add) X(Sub) X(Mul) X(Div) X(AddK) X(SubK) X(MulK) X(DivK)        \
+    X(AddAdd) X(AddSub) X(AddMul) X(AddDiv) X(SubAdd) X(SubSub) X(SubMul) X(SubDiv)      \
+    X(MulAdd) X(MulSub) X(MulMul) X(MulDiv) X(DivAdd) X(DivSub) X(DivMul) X(DivDiv)      \
+    X(Concat) X(Print) X(Read) X(Halt)
+
+enum class BcOp : uint8_t {
+#define BYTECODE_ENUM(name) name,
+    BYTECODE_OPS(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+const char* bcOpName(BcOp op); // "Move", "AddK", ...
+
+struct BcInstr {
+    BcOp op;
+    uint32_t a = 0, b = 0, c = 0, d = 0;
+};
+
+// A compiled program. Registers are the variables (in their resolved
+// slots), then the constants, then the temps of expressions. Temps are
+// reused as soon as their value is consumed, so a program needs only as
+// many as its deepest expression.
+struct Bytecode {
+    std::vector<BcInstr> code;            // ends with Halt
+    std::vector<int32_t> lines;           // parallel to code
+    std::vector<uint32_t> statements;     // first instruction of each statement, then Halt's
+    std::vector<Symbol> variables;        // register i < variables.size() holds variable variables[i]
+    std::vector<Value> constants;         // loaded into the registers after the variables
+    uint32_t registers = 0;
+
+    uint32_t constantBase() const { return static_cast<uint32_t>(variables.size()); }
+};
+
+// Compile `ast` with the variable slots `slots` resolved for it. Operator
+// chains like a * b + c become one superinstruction and arithmetic on an
+// integer constant takes it as an immediate. Variables are checked for an
+// assignment exactly where the tree walk would have read them, so errors
+// come out in the same order; reads resolved as always assigned are not
+// checked at all.
+Bytecode compileBytecode(const FlatAST& ast, const SymbolTable& symbols, const Resolution& slots);
+
+// Compile (optimized) IR to the same bytecode. A statement runs up to the
+// next STORE, PRINT or READ and an instruction that fails ends it, as in
+// the x86-64 backend, so output and errors match running the tree.
+Bytecode compileBytecode(const IRProgram& ir, const SymbolTable& symbols);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "flatast.h"
+#include "ir.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Everything a compilation produces before the program runs: the symbol
+// names (in Symbol order), the AST in flat form, the IR before and after
+// optimization, the assembly listing and the parser's recovered errors.
+struct CacheEntry {
+    std::vector<std::string> names;
+    FlatAST ast;
+    IRProgram ir;
+    IRProgram optimizedIR;
+    std::vector<std::string> assembly;
+    std::string diagnostics;
+};
+
+// On-disk cache of compilations, keyed by a hash of the source bytes, the
+// compiler version and the options that affect output. Each entry is one
+// file of length-prefixed, 8-byte aligned arrays that is mapped back with
+// SourceFile and copied out with memcpy - no parsing. A checksum over the
+// body rejects truncated or damaged files.
+//
+// Entries are written to a temporary file and renamed into place, so
+// concurrent compiler processes sharing a directory never see a partial
+// entry. A hit refreshes the entry's modification time; when the directory
+// grows past its size limit the least recently used entries are removed.
+// Unreadable or corrupt entries count as misses. One cache may be used by
+// several threads at once.
+class CompileCache {
+public:
+    struct Key {
+        uint64_t hi;
+        uint64_t lo;
+        uint64_t sourceSize;
+        std::string hex() const;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t stores = 0;
+        size_t evictions = 0;
+    };
+
+private:
+    std::string dir;
+    uint64_t maxBytes;
+    Stats counters;
+    std::mutex mutex;    // guards counters
+    std::mutex evicting;
+
+    std::string pathFor(const Key& key) const;
+    void count(size_t Stats::*counter);
+    void evict();
+
+public:
+    CompileCache(std::string dir, uint64_t maxBytes);
+
+    // `options` folds in every option that changes what is cached.
+    static Key keyFor(std::string_view source, uint64_t options);
+
+    bool load(const Key& key, CacheEntry& entry);
+    bool store(const Key& key, const CacheEntry& entry);
+
+    // read it once no other thread is using the cache
+    const Stats& stats() const { return counters; }
+};
+
+#endif
@@ -2,14 +2,27 @@
 #define CODEGEN_H
 
 #include "ir.h"
+#include "regalloc.h"
 #include <vector>
 #include <string>
 
 // This class is responsible for generating assembly code from IR.
 class CodeGenerator {
+private:
+    int registers;
+    AllocationStats lastStats;
+
 public:
-    // Generate toy assembly text lines from IR and return them
-    std::vector<std::string> generateAssembly(const std::vector<IRInstruction>& ir);
+    // Generated code uses the registers R0 .. R<registers - 1> (at least 2);
+    // values that do not fit are spilled to slots [S0], [S1], ...
+    explicit CodeGenerator(int registers = 8);
+
+    // Generate toy assembly text lines from IR and return them. Variable
+    // names and string literals are looked up in `symbols`.
+    std::vector<std::string> generateAssembly(const IRProgram& ir, const SymbolTable& symbols);
+
+    // Register allocation of the last generateAssembly() call.
+    const AllocationStats& allocationStats() const { return lastStats; }
 };
 
 #endif
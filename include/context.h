@@ -0,0 +1,15 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "arena.h"
+#include "symbols.h"
+
+// State owned by one compilation: the interned symbols and the arena every
+// AST node is allocated from. When the context goes out of scope the whole
+// AST is released with it.
+struct CompileContext {
+    SymbolTable symbols;
+    Arena arena;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef FLATAST_H
+#define FLATAST_H
+
+#include "parser.h"
+#include <cstdint>
+#include <vector>
+
+typedef uint32_t NodeIndex;
+const NodeIndex NO_NODE = UINT32_MAX;
+
+// Flat (structure-of-arrays) form of the AST. Node i is described by
+// kind[i], lhs[i], rhs[i], payload[i] and line[i]; children are indices into
+// the same arrays instead of pointers, so one node costs 21 bytes spread
+// over five dense arrays.
+//
+// Nodes are laid out in post-order: every child comes before its parent and
+// each statement's nodes form one contiguous block ending at its root. A
+// phase can therefore walk a statement front to back with a small value
+// stack instead of chasing pointers or recursing.
+struct FlatAST {
+    std::vector<NodeKind> kind;
+    std::vector<NodeIndex> lhs;     // BinOp lhs; Assign and Cout value
+    std::vector<NodeIndex> rhs;     // BinOp rhs
+    std::vector<int64_t> payload;   // Number value, Symbol, or BinOp operator char
+    std::vector<int32_t> line;
+    std::vector<NodeIndex> statements; // root of each statement, in source order
+
+    size_t size() const { return kind.size(); }
+
+    // First node of statement `s`; its nodes are [begin(s), statements[s]].
+    NodeIndex begin(size_t s) const { return s == 0 ? 0 : statements[s - 1] + 1; }
+
+    NodeIndex add(NodeKind k, int64_t value, int32_t ln, NodeIndex l = NO_NODE, NodeIndex r = NO_NODE);
+    // Drop every node from `size` on (a statement that failed to parse).
+    void truncate(size_t size);
+
+    // Build the flat form of a pointer AST (iteratively; no recursion).
+    // Parser::parseFlat() builds it from the source without the tree.
+    static FlatAST fromTree(const std::vector<ASTNode*>& nodes);
+};
+
+#endif
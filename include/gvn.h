@@ -0,0 +1,35 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include "passes.h"
+
+// Hash-based global value numbering over the SSA form of `ir` (see
+// SSAInfo). Every temp and immediate gets a value number; an instruction
+// whose (opcode, operand numbers) was already computed is deleted and its
+// uses read the earlier temp instead. That removes reloads of a variable
+// whose version has not changed, repeated arithmetic and the MOVs that
+// materialize literals and copies, which are forwarded into their uses.
+//
+// Arithmetic is folded and simplified only where the interpreter's
+// semantics allow it: operands must be known integers ("x" + 0 is "x0"),
+// folding wraps at 64 bits like the interpreter (INT64_MIN / -1 included),
+// and "+" commutes only on integers. Chains like (x + 1) + 2 and
+// (x * 2) * 3 are reassociated to x + 3 and x * 6.
+//
+// A runtime error abandons the rest of its statement, so a value from an
+// earlier statement is reused only if nothing in that statement up to its
+// definition can fault.
+//
+// Without `global` (-O1) a value is only reused inside the statement that
+// computes it: local value numbering.
+class ValueNumbering : public Pass {
+private:
+    bool global;
+
+public:
+    explicit ValueNumbering(bool global) : global(global) {}
+    const char* name() const override { return global ? "gvn" : "lvn"; }
+    bool run(DefUse& du, OptimizationReport& report) override;
+};
+
+#endif
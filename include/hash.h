@@ -0,0 +1,40 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fast non-cryptographic 64-bit hash of a byte range (8 bytes per step with
+// a MurmurHash3-style finalizer). Good enough to tell source ranges apart;
+// not meant to resist deliberate collisions.
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = seed ^ (size * k);
+
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ mix64(w)) * k;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, size);
+    return mix64(h ^ tail);
+}
+
+inline uint64_t hashBytes(std::string_view text, uint64_t seed = 0) {
+    return hashBytes(text.data(), text.size(), seed);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "context.h"
+#include "ir.h"
+#include "parser.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Everything the watch mode keeps for one top-level statement: its AST,
+// IR, optimized IR and assembly, plus what it reads and writes so that
+// semantic checks can be redone for just the statements an edit affects.
+struct StatementUnit {
+    int builtLine = 0; // first line of the range when it was parsed
+
+    std::vector<ASTNode*> nodes; // lines as of builtLine
+    // variables read before this statement assigns them, with their line
+    // relative to builtLine, in the order the semantic analyzer visits them
+    std::vector<std::pair<Symbol, int>> reads;
+    std::vector<Symbol> writes; // assign and cin targets
+    size_t arenaBytes = 0;
+
+    std::string diagnostics; // parse errors
+    IRProgram ir;
+    IRProgram optimizedIR; // without the optimizer's summary
+    std::vector<std::string> assembly;
+
+    int undeclaredRead = -1; // index into reads of the first use before assignment
+};
+
+// What one update() did.
+struct UpdateStats {
+    size_t statements = 0;
+    size_t rebuilt = 0;   // lexed, parsed, lowered and assembled again
+    size_t rechecked = 0; // reused, but semantic checks redone
+    size_t reused = 0;
+    bool compacted = false;
+    double milliseconds = 0;
+    std::vector<size_t> changed; // indices of the rebuilt statements
+};
+
+// Keeps a compilation alive between edits of one file. update() splits the
+// new text at statement boundaries and hashes every range. The unchanged
+// prefix and suffix are kept as they are; inside the edited region, hashes
+// are matched against the previous version in order, and only statements
+// without a match are parsed and lowered again. A statement whose variables
+// gained or lost a writer is re-checked for use-before-assignment, without
+// being rebuilt.
+//
+// Splitting and hashing still read the whole file, and a few passes walk
+// the small per-statement arrays below, but nothing else is proportional to
+// the file: reused statements are never touched.
+//
+// The symbol table and arena persist across updates, so Symbol ids stay
+// stable. Nodes of replaced statements stay in the arena until their bytes
+// outweigh the live ones; the next update then starts from a fresh context.
+//
+// Optimization is per statement: cross-statement passes must not run here.
+// So is type inference: a variable assigned by another statement has an
+// unknown type, its arithmetic stays untyped (ADD where a whole-program
+// compile emits IADD), and type errors are not reported.
+class IncrementalCompiler {
+private:
+    std::unique_ptr<CompileContext> ctx;
+    std::vector<std::unique_ptr<StatementUnit>> units;
+    // per-statement data read by every update, as parallel arrays
+    std::vector<uint64_t> hashes;     // of the statement's source range
+    std::vector<int> lines;           // current first line of the range
+    std::vector<Symbol> soleWrite;    // the only write, NO_SYMBOL, or MANY_WRITES
+    std::vector<uint64_t> readMasks;  // bit (symbol % 64) per read
+    std::vector<bool> lineSensitive;  // output quotes line numbers (errors, notes)
+    std::vector<bool> failing;        // has a use before assignment
+    size_t liveArenaBytes = 0;
+    int optLevel;
+    int registers;
+
+    static const Symbol MANY_WRITES = NO_SYMBOL - 1;
+
+    void build(size_t index, std::string_view text, int firstLine);
+    static void check(StatementUnit& unit, uint32_t position, const std::vector<uint32_t>& firstWrite);
+
+public:
+    // Optimizer level and CodeGenerator register count
+    explicit IncrementalCompiler(int optLevel = 2, int registers = 8);
+
+    UpdateStats update(std::string_view text);
+
+    size_t size() const { return units.size(); }
+    const StatementUnit& statement(size_t index) const { return *units[index]; }
+    int line(size_t index) const { return lines[index]; }
+    const SymbolTable& symbols() const { return ctx->symbols; }
+
+    // "Use of undeclared variable" message for statement `index`, or an
+    // empty string.
+    std::string semanticError(size_t index) const;
+    // First such error in source order, or an empty string.
+    std::string firstSemanticError() const;
+};
+
+#endif
@@ -2,23 +2,36 @@
 #define INTERPRETER_H
 
 #include "parser.h"
-#include <unordered_map>
+#include "flatast.h"
+#include "bytecode.h"
 #include <string>
 #include <vector>
 
-// This class is responsible for interpreting the AST and executing the program.
+// This class is responsible for executing the program. The AST is compiled
+// to register bytecode (see bytecode.h) and run by a dispatch loop over one
+// frame of Values; ints stay ints and only strings are ever parsed. cin and
+// cout go through the runtime's buffered I/O (runtime.h), flushed when a
+// program ends.
 class Interpreter {
 private:
-    std::unordered_map<std::string, std::string> variables;
+    const SymbolTable& symbols;
+    std::vector<Value> globals; // per Symbol: variables keep their values across execute() calls
+    std::vector<Value> frame;   // registers of the running program
+    const Bytecode* program = nullptr;
+    std::string error;          // message of the failed instruction
 
-    // Evaluate node and return its string representation (numbers converted to strings)
-    std::string eval(ASTNode* node);
-
-    // Helper to check if string represents an integer and parse it
-    bool tryParseInt(const std::string& s, int& out);
+    // The checked path of an arithmetic instruction: undefined or string
+    // operands, a zero divisor. Registers b and c (UINT32_MAX for none)
+    // name the operands in errors. Returns false with `error` set.
+    bool arith(char op, const Value& left, const Value& right, uint32_t b, uint32_t c, int line, Value& out);
+    void undefined(uint32_t reg, int line);
 
 public:
+    explicit Interpreter(const SymbolTable& symbols);
     void execute(const std::vector<ASTNode*>& nodes);
+    void execute(const FlatAST& ast);
+    void execute(const IRProgram& ir); // the (optimized) IR instead of the tree
+    void execute(const Bytecode& bc); // an already compiled program
 };
 
 #endif
@@ -2,22 +2,131 @@
 #define IR_H
 
 #include "parser.h"
+#include "flatast.h"
+#include <cstdint>
+#include <iostream>
 #include <string>
 #include <vector>
 
-// Intermediate representation instruction
+// IR opcodes; every phase dispatches on them with a switch.
+enum class IROp : uint8_t {
+    Mov,   // result = arg1
+    Load,  // result (temp) = variable arg1
+    Store, // variable result = arg1
+    Print, // print arg1
+    Read,  // variable result = next input token
+    Add,   // result = arg1 op arg2, adding or concatenating as the values
+    Sub,   // turn out at run time
+    Mul,
+    Div,
+    IAdd,  // the same on operands SemanticAnalyzer proved to be ints
+    ISub,
+    IMul,
+    IDiv,
+    Concat, // "+" with an operand proved never to be a number: concatenates
+    Nop    // deleted by an optimization pass, until the program is compacted
+};
+
+const char* irOpName(IROp op); // "MOV", "ADD", ...
+
+// ADD, SUB, MUL or DIV for a typed arithmetic op (CONCAT is ADD); any other
+// op is returned as it is.
+inline IROp untypedOp(IROp op) {
+    if (op >= IROp::IAdd && op <= IROp::IDiv)
+        return static_cast<IROp>(static_cast<int>(op) - static_cast<int>(IROp::IAdd) + static_cast<int>(IROp::Add));
+    return op == IROp::Concat ? IROp::Add : op;
+}
+
+enum class OperandKind : uint8_t {
+    None,
+    Temp, // id is the temp number (printed "t<id>")
+    Var,  // id is the variable's Symbol
+    Int,  // id indexes IRProgram::ints
+    Str   // id is the string literal's Symbol
+};
+
+struct Operand {
+    OperandKind kind = OperandKind::None;
+    uint32_t id = 0;
+
+    static Operand temp(uint32_t n) { return {OperandKind::Temp, n}; }
+    static Operand var(Symbol name) { return {OperandKind::Var, name}; }
+    static Operand str(Symbol text) { return {OperandKind::Str, text}; }
+
+    bool operator==(const Operand& o) const { return kind == o.kind && id == o.id; }
+    bool operator!=(const Operand& o) const { return !(*this == o); }
+};
+
+// One IR instruction in 16 bytes: the opcode, the three operand kinds, then
+// the three operand ids.
 struct IRInstruction {
-    std::string op;
-    std::string arg1;
-    std::string arg2;
-    std::string result;
+    IROp op;
+    OperandKind kinds[3]; // arg1, arg2, result
+    uint32_t ids[3];
+
+    IRInstruction() : IRInstruction(IROp::Mov, Operand()) {}
+    IRInstruction(IROp op, Operand result, Operand arg1 = {}, Operand arg2 = {})
+        : op(op), kinds{arg1.kind, arg2.kind, result.kind}, ids{arg1.id, arg2.id, result.id} {}
+
+    Operand arg1() const { return {kinds[0], ids[0]}; }
+    Operand arg2() const { return {kinds[1], ids[1]}; }
+    Operand result() const { return {kinds[2], ids[2]}; }
+};
+
+// Comment, error or optimizer message attached to the IR. It is printed on
+// its own line just before instruction `before` (or after the last one when
+// `before` is the instruction count); notes at the same spot keep their order.
+struct IRNote {
+    uint32_t before;
+    std::string text; // including the leading "; "
 };
 
-// Intermediate representation generator
+// A whole program's IR: the instructions, the integer immediates they refer
+// to, the source line of each instruction (for runtime error messages) and
+// the diagnostics side table. Variable names and string literals are
+// Symbols of the compilation's SymbolTable.
+struct IRProgram {
+    std::vector<IRInstruction> code;
+    std::vector<uint32_t> lines; // parallel to code
+    std::vector<int64_t> ints;
+    std::vector<IRNote> notes; // sorted by `before`
+    uint32_t temps = 0;        // temps are numbered 1 .. temps
+
+    Operand imm(int64_t value) {
+        ints.push_back(value);
+        return {OperandKind::Int, static_cast<uint32_t>(ints.size() - 1)};
+    }
+    int64_t intValue(Operand o) const { return ints[o.id]; }
+
+    void emit(const IRInstruction& ins, int line) {
+        code.push_back(ins);
+        lines.push_back(static_cast<uint32_t>(line));
+    }
+    // Line of instruction i, 0 if unknown.
+    uint32_t line(size_t i) const { return i < lines.size() ? lines[i] : 0; }
+
+    void note(std::string text) { notes.push_back({static_cast<uint32_t>(code.size()), std::move(text)}); }
+};
+
+// Text of one operand as the IR listing shows it: t3, x, 42 or "text".
+std::string operandText(const IRProgram& ir, Operand o, const SymbolTable& symbols);
+
+// Print `ir` in the textual format ("ADD t1 t2 -> t3", "; note", ...).
+void printIR(const IRProgram& ir, const SymbolTable& symbols, std::ostream& out);
+
+// Intermediate representation generator. Arithmetic is typed where the
+// operand types are known: from each node's type (set by
+// SemanticAnalyzer::analyze) for the tree, from SemanticAnalyzer::resolve
+// for the flat AST.
 class IRGenerator {
+private:
+    const SymbolTable& symbols;
+
 public:
-    std::vector<IRInstruction> generate(const std::vector<ASTNode*>& ast);
-    void genNode(ASTNode* node, std::vector<IRInstruction>& ir);
+    explicit IRGenerator(const SymbolTable& symbols);
+    IRProgram generate(const std::vector<ASTNode*>& ast);
+    IRProgram generate(const FlatAST& ast); // same IR, linear walk
+    void genNode(ASTNode* node, IRProgram& ir);
 };
 
 #endif
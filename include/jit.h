@@ -0,0 +1,49 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "ir.h"
+#include "regalloc.h"
+#include "x86.h"
+#include <string>
+
+// In-process JIT: the x86-64 lowering of the native backend, encoded
+// straight into executable memory and called like a function. Runtime
+// helpers are the rt_* functions of runtime/runtime.c, linked into the
+// compiler; no assembler or linker runs.
+//
+// One mapping holds the code, then (on its own pages) the data: the
+// helper addresses, string constants and variable words. The code pages
+// are made read-only and executable once everything is in place; the data
+// stays writable.
+class JitProgram {
+private:
+    unsigned char* memory = nullptr;
+    size_t mapped = 0;
+    size_t code = 0;
+    AllocationStats lastStats;
+
+    void release();
+
+public:
+    JitProgram() = default;
+    ~JitProgram();
+
+    JitProgram(const JitProgram&) = delete;
+    JitProgram& operator=(const JitProgram&) = delete;
+
+    // Encode `ir`, with temps in `registers` registers as X86CodeGenerator
+    // has them. Returns false with the reason in `error` if executable
+    // memory cannot be had.
+    bool compile(const IRProgram& ir, const SymbolTable& symbols, std::string& error,
+                 int registers = X86CodeGenerator::REGISTERS);
+    bool compiled() const { return memory != nullptr; }
+
+    // Run the program once, reading stdin and writing stdout like the
+    // interpreter. Variables keep their values from an earlier run.
+    void run() const;
+
+    size_t codeSize() const { return code; }
+    const AllocationStats& allocationStats() const { return lastStats; }
+};
+
+#endif
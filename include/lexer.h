@@ -2,22 +2,26 @@
 #define LEXER_H
 
 #include "token.h"
-#include <string>
+#include <string_view>
 
+// The Lexer does not own its input: `text` must outlive the Lexer and every
+// Token it returns (see SourceFile).
 class Lexer {
 private:
-    std::string text;
+    std::string_view text;
+    SymbolTable* symbols;
     size_t pos; // tracks current position in the input text
     int line;
     char currentChar();
 
     void skipWhitespaceAndComments();
-    std::string number();
-    std::string identifier();
-    std::string stringLiteral();
+    std::string_view number();
+    std::string_view identifier();
+    std::string_view stringLiteral();
 
 public:
-    Lexer(const std::string& text);
+    // `firstLine` is the line number of text[0] (for lexing part of a file)
+    Lexer(std::string_view text, SymbolTable& symbols, int firstLine = 1);
     Token getNextToken();
 };
 
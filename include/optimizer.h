@@ -2,13 +2,28 @@
 #define OPTIMIZER_H
 
 #include "ir.h"
+#include "passes.h"
 #include <vector>
 
 // This class is responsible for optimizing the intermediate representation (IR) of the code.
 class Optimizer {
+private:
+    int level;
+    std::vector<PassStats> stats;
+    size_t lastRounds = 0;
+
 public:
-    // Apply small, local optimizations to the IR and return a new IR list.
-    std::vector<IRInstruction> optimize(const std::vector<IRInstruction>& ir);
+    // -O0 runs no passes, -O1 statement-local ones (value numbering inside a
+    // statement, dead code), -O2 the whole-program ones.
+    explicit Optimizer(int level = 2);
+
+    // Run the level's passes to a fixed point and return the new program.
+    // A summary of what changed is added as notes before the first instruction.
+    IRProgram optimize(const IRProgram& ir);
+
+    // Per-pass statistics of the last optimize() call.
+    const std::vector<PassStats>& passStats() const { return stats; }
+    size_t rounds() const { return lastRounds; }
 };
 
 #endif
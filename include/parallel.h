@@ -0,0 +1,40 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "context.h"
+#include "parser.h"
+#include "threadpool.h"
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+// A run of whole statements inside a source text.
+struct SourceChunk {
+    size_t begin;
+    size_t end;
+    int firstLine; // line number of text[begin]
+};
+
+// Split `text` into at most `chunks` pieces of roughly equal size. Pieces
+// end right after a top-level ';' (never inside a string literal or a
+// comment), so each one holds whole statements and can be parsed on its own.
+std::vector<SourceChunk> splitStatements(std::string_view text, size_t chunks);
+
+// Split `text` at every such boundary: one piece per statement (a piece may
+// hold more than one if a boundary cannot be cut safely), each including the
+// whitespace and comments that precede it. Whitespace and comments after the
+// last statement are left out.
+std::vector<SourceChunk> statementRanges(std::string_view text);
+
+// Parallel front end. The grammar is a flat list of ';'-terminated
+// statements, so the source is split with splitStatements() and every chunk
+// is lexed and parsed on `pool` into its own arena and symbol table. The
+// results are then merged into `ctx` in source order: symbols are re-interned
+// into ctx.symbols, the chunk arenas are adopted by ctx.arena, and parse
+// errors are written to `diag` in the order a sequential parse reports them.
+// Inputs smaller than `minChunkBytes` per chunk are split into fewer chunks.
+std::vector<ASTNode*> parseParallel(std::string_view text, CompileContext& ctx, ThreadPool& pool,
+                                    std::ostream& diag = std::cerr,
+                                    size_t minChunkBytes = 256 * 1024);
+
+#endif
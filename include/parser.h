@@ -2,45 +2,79 @@
 #define PARSER_H
 
 #include "lexer.h"
+#include "arena.h"
+#include <cstdint>
+#include <exception>
+#include <iostream>
 #include <vector>
-#include <string>
 
-// ASTNode represents a node in the abstract syntax tree
+// Kind of an AST node; every phase dispatches on it with a switch.
+enum class NodeKind : uint8_t {
+    Number,   // integer literal
+    String,   // string literal
+    Variable, // variable reference
+    BinOp,    // left op right
+    Assign,   // symbol = left
+    Cin,      // cin(symbol)
+    Cout      // cout(left)
+};
+
+const char* nodeKindName(NodeKind kind);
+
+// Static type of an expression, as SemanticAnalyzer infers it: Int is an
+// int whenever the program runs; String is a string holding a character no
+// number has, so it never reads as one, and neither does anything
+// concatenated with it; Unknown is anything else (input, literals such as
+// "12", or a variable whose type depends on which statements failed).
+enum class ValueType : uint8_t { Unknown, Int, String };
+
+// ASTNode represents a node in the abstract syntax tree. Nodes are allocated
+// from the compilation's Arena and are never freed individually.
 struct ASTNode {
-    std::string type;
-    std::string name;
-    std::string value;
-    std::string op;
-    ASTNode* left;
-    ASTNode* right;
+    NodeKind kind;
+    char op; // BinOp: '+', '-', '*' or '/'
+    ValueType type; // of the value, once SemanticAnalyzer::analyze has run
     int line;
+    union {
+        long long number; // Number
+        Symbol symbol;    // String contents; Variable, Assign and Cin name
+    };
+    ASTNode* left;  // BinOp lhs; Assign and Cout value
+    ASTNode* right; // BinOp rhs
 
-    // Constructor for ASTNode
-    ASTNode(std::string type,
-            std::string name = "",
-            std::string value = "",
-            std::string op = "",
-            ASTNode* left = nullptr,
-            ASTNode* right = nullptr,
-            int line = 0)
-        : type(type), name(name), value(value), op(op), left(left), right(right), line(line) {}
+    ASTNode(NodeKind kind, int line, ASTNode* left = nullptr, ASTNode* right = nullptr)
+        : kind(kind), op(0), type(ValueType::Unknown), line(line), number(0), left(left), right(right) {}
 };
 
+struct FlatAST;
+
 class Parser {
 private:
     Lexer lexer;
+    Arena& arena;
+    std::ostream& diag; // where recovered parse errors are reported
     Token currentToken;
 
     void eat(TokenType type);
-    ASTNode* factor();
-    ASTNode* term();
-    ASTNode* expr();
-    ASTNode* assignment();
-    ASTNode* statement();
+    void recover(const std::exception& error);
+
+    // The grammar, written once for both outputs: `B` builds either
+    // pointer nodes or FlatAST entries (see parser.cpp).
+    template <class B> typename B::Node operand(B& build);
+    template <class B> typename B::Node expr(B& build);
+    template <class B> typename B::Node assignment(B& build);
+    template <class B> typename B::Node statement(B& build);
 
 public:
-    Parser(Lexer lexer);
+    // The Lexer only holds a view of the source, so taking it by value is cheap.
+    // Nodes are allocated from `arena`, which must outlive the returned AST.
+    Parser(Lexer lexer, Arena& arena, std::ostream& diag = std::cerr);
     std::vector<ASTNode*> parse();
+
+    // The same program straight into the flat layout (flatast.h), with the
+    // same nodes in the same order as FlatAST::fromTree(parse()) and the
+    // same errors; no tree is built and the arena is not used.
+    FlatAST parseFlat();
 };
 
 #endif
@@ -0,0 +1,152 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "ir.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Def-use index over a program that passes edit in place. Every temp has
+// its defining instruction and a doubly linked list of the operand slots
+// that read it, threaded through two arrays indexed by slot (instruction *
+// 2 + argument), so removing an instruction or redirecting a temp's uses
+// updates the index in time proportional to the change.
+//
+// Removed instructions become NOPs and keep their index, so notes and the
+// positions passes hold stay valid; compact() drops them at the end.
+class DefUse {
+private:
+    IRProgram& ir;
+    std::vector<uint32_t> defs;  // per temp: defining instruction or NO_SLOT
+    std::vector<uint32_t> first; // per temp: first reading slot or NO_SLOT
+    std::vector<uint32_t> count; // per temp: number of reading slots
+    std::vector<uint32_t> next;  // per slot
+    std::vector<uint32_t> prev;  // per slot
+    size_t nops = 0;
+
+    void build();
+    void link(uint32_t slot);
+    void unlink(uint32_t slot);
+
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    explicit DefUse(IRProgram& ir);
+
+    IRProgram& program() { return ir; }
+    const IRInstruction& at(uint32_t i) const { return ir.code[i]; }
+    size_t size() const { return ir.code.size(); }
+    size_t liveInstructions() const { return ir.code.size() - nops; }
+
+    uint32_t definition(uint32_t temp) const { return defs[temp]; }
+    uint32_t uses(uint32_t temp) const { return count[temp]; }
+
+    // Call f(instruction, argument) for every read of `temp`.
+    template <typename F>
+    void forEachUse(uint32_t temp, F f) const {
+        for (uint32_t s = first[temp]; s != NO_SLOT;) {
+            uint32_t n = next[s]; // f may unlink s
+            f(s / 2, static_cast<int>(s % 2));
+            s = n;
+        }
+    }
+
+    // Make every reader of `temp` read `with` instead.
+    void replaceUses(uint32_t temp, Operand with);
+    // Set argument `k` (0 or 1) of instruction `i`.
+    void setArgument(uint32_t i, int k, Operand o);
+    // Overwrite instruction `i`, which keeps defining the same result.
+    void rewrite(uint32_t i, const IRInstruction& ins);
+    // Turn instruction `i` into a NOP.
+    void remove(uint32_t i);
+
+    // Drop the NOPs, moving notes to the next remaining instruction, and
+    // rebuild the index for the shorter program.
+    void compact();
+};
+
+// What the passes did, for the summary notes in front of the optimized
+// listing.
+struct OptimizationReport {
+    bool deadCode = false;     // unused computations removed
+    size_t redundant = 0;      // recomputations of an available value
+    size_t forwarded = 0;      // loads replaced by the value last stored
+    size_t reassociated = 0;   // constant chains merged into one instruction
+    bool copies = false;       // MOVs forwarded into their uses
+    bool divByZero = false;    // a DIV by constant zero was left in place
+    size_t deadStores = 0;     // STOREs no later instruction reads
+    size_t deadStoreCode = 0;  // ... and instructions computing their values
+    std::vector<std::string> foldedExamples; // "(2 + 3) -> 5", the first EXAMPLES
+
+    static constexpr size_t EXAMPLES = 3;
+};
+
+// One transformation over the program. Running a pass twice in a row
+// must not change anything the second time.
+class Pass {
+public:
+    virtual ~Pass() = default;
+    virtual const char* name() const = 0;
+    // Edit the program through `du`; returns whether anything changed.
+    virtual bool run(DefUse& du, OptimizationReport& report) = 0;
+};
+
+struct PassStats {
+    std::string name;
+    size_t runs = 0;
+    size_t changes = 0; // runs that changed something
+    size_t removed = 0; // instructions removed, over all runs
+    double milliseconds = 0;
+};
+
+// Runs its passes in order, over and over until a whole round changes
+// nothing (or maxRounds is reached): a fold that exposes a dead store can
+// in turn make more code dead, and so on. A pass is skipped when nothing
+// changed since its own last run.
+class PassManager {
+private:
+    std::vector<std::unique_ptr<Pass>> passes;
+    std::vector<PassStats> stats;
+    size_t lastRounds = 0;
+
+public:
+    size_t maxRounds = 16;
+
+    void add(std::unique_ptr<Pass> pass);
+    bool empty() const { return passes.empty(); }
+
+    // Optimize `ir` in place.
+    void run(IRProgram& ir, OptimizationReport& report);
+
+    const std::vector<PassStats>& statistics() const { return stats; }
+    size_t rounds() const { return lastRounds; }
+};
+
+// Removes instructions whose result is never used, following the def-use
+// chains so a whole dead expression goes at once. Anything that can raise
+// a runtime error stays: the error is part of the program's output.
+class DeadCodePass : public Pass {
+public:
+    const char* name() const override { return "dce"; }
+    bool run(DefUse& du, OptimizationReport& report) override;
+};
+
+// Liveness-based dead store elimination. Walking backwards, a variable is
+// live from a read up to the STORE or READ that certainly assigns it; a
+// STORE to a variable that is not live is removed together with the
+// expression computing its value. Variables that are never read lose all
+// their stores. A dead STORE whose statement can fault before it stays,
+// with its expression: the error is output, and the STORE marks where the
+// abandoned statement ends. READ always stays: it
+// consumes input. Statements are never reordered.
+//
+// Nothing is live at the end of the program, so this is only correct on
+// whole programs.
+class DeadStorePass : public Pass {
+public:
+    const char* name() const override { return "dse"; }
+    bool run(DefUse& du, OptimizationReport& report) override;
+};
+
+#endif
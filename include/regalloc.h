@@ -0,0 +1,56 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ir.h"
+#include <cstdint>
+#include <vector>
+
+// A value the generated code keeps in a register, alive over the positions
+// [start, end]. Instruction i reads its operands at position 2 * i and
+// writes its result at 2 * i + 1, so a result can take the register of an
+// operand that dies in the same instruction.
+struct LiveInterval {
+    uint32_t start = 0, end = 0;
+    bool literal = false; // loaded from a constant or variable for one use: never stored
+    int reg = -1;         // physical register, or -1 when spilled
+    int slot = -1;        // spill slot of a spilled non-literal value
+};
+
+struct AllocationStats {
+    int registers = 0;        // size of the register file
+    int used = 0;             // registers the code actually uses
+    int scratch = 0;          // of those, reserved for spill code
+    size_t intervals = 0;
+    size_t maxPressure = 0;   // most values alive at once
+    size_t spilled = 0;       // intervals kept in memory
+    size_t spillStores = 0;   // SPILL instructions emitted
+    size_t reloads = 0;       // RELOAD instructions emitted
+    size_t rematerialized = 0; // spilled constants loaded again instead
+    size_t slots = 0;         // spill slots
+};
+
+// Register assignment for one program. Liveness is computed over the
+// straight-line IR: every temp lives from its definition to its last read.
+// Literal operands of arithmetic and STORE, and the variables PRINT and
+// READ go through, get one-position intervals of their own.
+//
+// Intervals are allocated by linear scan (Poletto and Sarkar): sweeping by
+// start, expired intervals return their register, and when none is free
+// the interval that ends last is spilled for its whole lifetime. If that
+// happens, the scan is redone with `scratch` registers held back for the
+// reloads of spilled operands and the store of a spilled result (a target
+// whose instructions can address the slots directly needs none). Spill
+// slots are reused once their value is dead.
+struct RegisterAllocation {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<LiveInterval> intervals; // sorted by start
+    std::vector<uint32_t> operand;       // per slot (instruction * 2 + argument): interval or NONE
+    std::vector<uint32_t> result;        // per instruction: interval or NONE
+    AllocationStats stats;               // without the counts codegen fills in
+
+    // `registers` must be at least `scratch`, and at least 1.
+    static RegisterAllocation build(const IRProgram& ir, int registers, int scratch = 2);
+};
+
+#endif
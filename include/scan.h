@@ -0,0 +1,45 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+// Byte-run scanners used by the Lexer. Each one classifies 16 (SSE2) or 32
+// (AVX2) bytes per step where the CPU supports it and falls back to a plain
+// scalar loop otherwise. The implementation is picked once at startup from
+// the CPU's features; forceLevel() lets benchmarks compare them.
+//
+// All functions take a half-open range [p, end) and never read past `end`.
+namespace scan {
+
+enum class Level { Scalar, SSE2, AVX2 };
+
+Level activeLevel();
+// Select an implementation. Requests above what the CPU supports are clamped.
+void forceLevel(Level level);
+const char* levelName(Level level);
+
+// First byte that is not C-locale whitespace (" \t\n\v\f\r"); adds the
+// number of '\n' bytes skipped to `lines`.
+const char* skipSpace(const char* p, const char* end, int& lines);
+
+// First byte that is not [A-Za-z0-9_].
+const char* identEnd(const char* p, const char* end);
+
+// First byte that is not [0-9].
+const char* digitEnd(const char* p, const char* end);
+
+// First occurrence of `c`, or `end`.
+const char* findByte(const char* p, const char* end, char c);
+
+// First occurrence of either `a` or `b`, or `end`.
+const char* findEither(const char* p, const char* end, char a, char b);
+
+// Start of the first "*/" pair, or `end` if the comment is never closed.
+const char* findCommentClose(const char* p, const char* end);
+
+// Number of '\n' bytes in [p, end).
+int countNewlines(const char* p, const char* end);
+
+}
+
+#endif
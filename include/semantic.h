@@ -2,18 +2,64 @@
 #define SEMANTIC_H
 
 #include "parser.h"
-#include <unordered_map>//used as symbol table
+#include "flatast.h"
 #include <string>
+#include <utility>
 #include <vector>
 
+// Where each variable lives at run time. Slots are numbered in order of
+// first appearance; a read that is marked assigned comes after a statement
+// that assigned the variable and could not have failed, so it needs no
+// check for a missing value.
+struct Resolution {
+    std::vector<Symbol> slots;    // slot i holds variable slots[i]
+    std::vector<uint32_t> slotOf; // per Symbol, or UINT32_MAX
+    std::vector<bool> assigned;   // per node of the flat AST: a Variable read that is always assigned
+    std::vector<ValueType> types; // per node of the flat AST: the type of its value
+    NodeIndex undeclared = NO_NODE; // first read of a variable no statement before it assigns
+};
+
+// Besides declarations, the analyzer infers the type of every expression,
+// following the program statement by statement: what each variable holds
+// after a statement depends on whether the statement can fail (a failed
+// statement leaves its target as it was). "+" on two ints adds and "+"
+// with a String concatenates; "-", "*" and "/" give an int, or fail, and
+// always fail on a String: those are reported as type errors.
 class SemanticAnalyzer {
 private:
-    std::unordered_map<std::string, bool> declared;
+    // What is known about a variable between statements
+    struct VariableState {
+        ValueType type = ValueType::Unknown;
+        bool assigned = false; // may hold a value, of `type`
+        bool certain = false;  // always holds one
+    };
+
+    const SymbolTable& symbols;
+    std::vector<bool> declared; // symbol table: indexed by Symbol
     // used to track declared variables
+    std::vector<std::pair<ASTNode*, bool>> work; // nodes still to visit in analyzeNode, and whether their operands are done
+    std::vector<VariableState> variables;        // indexed by Symbol
+    std::vector<std::string> errors;             // type errors, in source order
+
+    void declare(Symbol name);
+    bool isDeclared(Symbol name) const;
+    VariableState& variable(Symbol name);
+    ValueType literalType(Symbol text) const;
+    ValueType read(Symbol name, bool& mayFail);
+    ValueType operation(char op, ValueType left, ValueType right, bool constantDivisor, bool& mayFail, bool& fails);
+    void assign(Symbol target, ValueType value, bool mayFail, bool fails);
+    void typeError(char op, int line);
 
 public:
+    explicit SemanticAnalyzer(const SymbolTable& symbols);
     void analyze(const std::vector<ASTNode*>& ast);
-    void analyzeNode(ASTNode* node);// check variable declarations node by node
+    void analyze(const FlatAST& ast); // same checks, one linear pass per statement
+    Resolution resolve(const FlatAST& ast); // the pass analyze(FlatAST) checks; never throws
+    void analyzeNode(ASTNode* node);// check variable declarations node by node, and set each node's type
+
+    // "Cannot multiply non-numeric values at line 3": the first operator of
+    // each statement that fails whenever it runs
+    const std::vector<std::string>& typeErrors() const { return errors; }
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <string>
+#include <string_view>
+
+// SourceFile owns the bytes of one input file for the whole compilation.
+// On POSIX systems the file is memory-mapped read-only, so the Lexer and its
+// Tokens can hand out std::string_view slices of it without copying anything.
+// Elsewhere (and for empty files, which cannot be mapped) the bytes are read
+// into an owned buffer instead; callers only ever see text().
+class SourceFile {
+private:
+    const char* data;
+    size_t size;
+    bool mapped;
+    std::string owned; // fallback storage when the file is not mapped
+
+    void release();
+
+public:
+    SourceFile();
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    SourceFile(SourceFile&& other) noexcept;
+    SourceFile& operator=(SourceFile&& other) noexcept;
+
+    // Open and map `path`. Returns false if the file cannot be opened.
+    bool open(const std::string& path);
+
+    // Use an in-memory string as the source (copied into owned storage).
+    void assign(std::string_view text);
+
+    std::string_view text() const { return std::string_view(data, size); }
+    bool isMapped() const { return mapped; }
+};
+
+#endif
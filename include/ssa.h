@@ -0,0 +1,63 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "ir.h"
+#include <cstdint>
+#include <vector>
+
+// What is known at compile time about the value of a temp or operand. The
+// interpreter decides per operation whether a value is a number (an int,
+// or a string that reads as one), so "integer" here means the value is an
+// int, which every arithmetic result is.
+struct ValueFacts {
+    bool isInt = false;   // an int (arithmetic is exact on it)
+    bool isConst = false; // an integer immediate, `constant`
+    int64_t constant = 0;
+
+    bool numeric() const { return isInt || isConst; }
+};
+
+ValueFacts intConstant(int64_t value);
+
+// Facts about the result of arithmetic `op` on operands with facts `a`, `b`.
+// Typed ops (IADD ... CONCAT) carry what the semantic analyzer proved.
+ValueFacts arithmeticResult(IROp op, const ValueFacts& a, const ValueFacts& b);
+
+// Whether arithmetic `op` can raise a runtime error ("Cannot subtract
+// non-numeric values", "Division by zero", ...) on such operands.
+bool arithmeticCanFault(IROp op, const ValueFacts& a, const ValueFacts& b);
+
+// Fold arithmetic on two integer immediates exactly as the interpreter
+// evaluates it. Returns false if it would raise an error instead.
+bool foldArithmetic(IROp op, int64_t a, int64_t b, int64_t& result);
+
+// True for the instruction that ends a statement (STORE, PRINT, READ). A
+// runtime error abandons the rest of the statement up to its terminator.
+inline bool endsStatement(IROp op) {
+    return op == IROp::Store || op == IROp::Print || op == IROp::Read;
+}
+
+const uint32_t NO_VERSION = UINT32_MAX;
+const uint32_t NO_DEF = UINT32_MAX;
+
+// SSA view of a straight-line IR program. Temps are already assigned once;
+// variables are the only names assigned more than once, so every STORE and
+// READ starts a new version of its variable and every LOAD (or PRINT of a
+// variable) reads the version current at that point. A variable's value on
+// entry is a version with no defining instruction.
+//
+// Alongside the versions this records def-use information for temps and,
+// from a forward pass over the facts above, which instructions can fault.
+struct SSAInfo {
+    std::vector<uint32_t> version;    // per instruction: version defined or read, or NO_VERSION
+    std::vector<uint32_t> statement;  // per instruction: index of its statement
+    std::vector<bool> canFault;       // per instruction
+    std::vector<uint32_t> tempDef;    // per temp: defining instruction, or NO_DEF
+    std::vector<uint32_t> tempUses;   // per temp: number of instructions using it
+    std::vector<Symbol> versionVar;   // per version: its variable
+    std::vector<uint32_t> versionDef; // per version: STORE/READ, or NO_DEF on entry
+
+    static SSAInfo build(const IRProgram& ir);
+};
+
+#endif
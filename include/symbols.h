@@ -0,0 +1,29 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Dense integer id for an interned identifier or string literal.
+typedef uint32_t Symbol;
+const Symbol NO_SYMBOL = UINT32_MAX;
+
+// Interning table shared by every phase of one compilation. The Lexer interns
+// each identifier and string literal once; later phases compare and hash the
+// Symbol instead of the text, and only go back to the text for messages and
+// output.
+class SymbolTable {
+private:
+    std::deque<std::string> names; // deque: stored strings never move
+    std::unordered_map<std::string_view, Symbol> ids; // keys view into `names`
+
+public:
+    Symbol intern(std::string_view text);
+    const std::string& name(Symbol id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
+
+#endif
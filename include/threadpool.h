@@ -0,0 +1,48 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run index-parallel loops. The calling
+// thread takes part in every loop, so a pool of size 1 runs everything
+// inline. Tasks must not throw; capture failures into per-index results.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // the loop currently being run (one at a time)
+    const std::function<void(size_t)>* task;
+    size_t count;
+    std::atomic<size_t> next;
+    size_t active;       // workers still inside the current loop
+    unsigned generation; // bumped for every new loop
+    bool stopping;
+
+    void workerMain();
+    void drain();
+
+public:
+    // `threads` is the total parallelism including the caller; 0 means one
+    // per hardware thread.
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Run task(0) .. task(count - 1) and return once all of them are done.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+};
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <string>
+#include "symbols.h"
+#include <string_view>
 
 enum TokenType {
     NUMBER,
@@ -21,13 +22,17 @@ enum TokenType {
     UNKNOWN
 };
 
+// A token's value is a view into the source text held by the Lexer's
+// SourceFile, so producing a token never allocates. IDENTIFIER and STRING
+// tokens also carry the interned Symbol of their text.
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     int line;
+    Symbol symbol;
     
-    Token(TokenType type, std::string value = "", int line = 0)
-        : type(type), value(value), line(line) {}
+    Token(TokenType type, std::string_view value = {}, int line = 0, Symbol symbol = NO_SYMBOL)
+        : type(type), value(value), line(line), symbol(symbol) {}
 };
 
 #endif
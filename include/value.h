@@ -0,0 +1,102 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstdint>
+#include <string_view>
+
+// Bytes of string values, shared by every Value viewing them and freed with
+// the last one. A Value is a prefix of the bytes; when it is the longest
+// one (its length is `used`), "+" appends to the same body in place,
+// growing it by doubling, so building a string piece by piece costs time
+// linear in its final length. The bytes a shorter view sees never change.
+// Whether a view is a number is worked out the first time it is asked and
+// kept, for the length asked about.
+struct StringBody {
+    uint32_t refs;
+    int8_t numeric;           // 1 or 0, -1 until first asked
+    uint32_t numericLength;   // the view length `numeric` and `number` are for
+    int64_t number;           // the number, if numeric
+    size_t used, capacity;
+
+    char* text() { return reinterpret_cast<char*>(this + 1); }
+};
+
+// A runtime value: nothing yet (a variable never assigned), a 64-bit int,
+// or a string. Arithmetic results are ints and wrap around; a string is a
+// number when std::stol reads all of it, and its text is kept as it was
+// for printing. The dispatch loop reads `kind`, `i` and `s` directly.
+struct Value {
+    enum class Kind : uint8_t { None, Int, Str };
+    Kind kind = Kind::None;
+    uint32_t length = 0; // Str: how many bytes of `s` this value is
+    union {
+        int64_t i;
+        StringBody* s;
+    };
+
+    Value() : i(0) {}
+    Value(const Value& v) : kind(v.kind), length(v.length), i(v.i) {
+        if (kind == Kind::Str) ++s->refs;
+    }
+    Value(Value&& v) noexcept : kind(v.kind), length(v.length), i(v.i) { v.kind = Kind::None; }
+    ~Value() {
+        if (kind == Kind::Str) release(s);
+    }
+    Value& operator=(const Value& v) {
+        if (v.kind == Kind::Str) ++v.s->refs;
+        if (kind == Kind::Str) release(s);
+        kind = v.kind;
+        length = v.length;
+        i = v.i;
+        return *this;
+    }
+    Value& operator=(Value&& v) noexcept {
+        if (this != &v) {
+            if (kind == Kind::Str) release(s);
+            kind = v.kind;
+            length = v.length;
+            i = v.i;
+            v.kind = Kind::None;
+        }
+        return *this;
+    }
+
+    static Value integer(int64_t n) {
+        Value v;
+        v.kind = Kind::Int;
+        v.i = n;
+        return v;
+    }
+    static Value string(std::string_view text);
+    // left's text followed by right's, appended in place when left is the
+    // longest view of its body; neither may be None
+    static Value concat(const Value& left, const Value& right);
+
+    void setInt(int64_t n) {
+        if (kind == Kind::Str) release(s);
+        kind = Kind::Int;
+        i = n;
+    }
+
+    // The number this value stands for: an int, or a string that reads as
+    // one.
+    bool numeric(int64_t& out) const {
+        if (kind == Kind::Int) {
+            out = i;
+            return true;
+        }
+        return kind == Kind::Str && stringNumber(s, length, out);
+    }
+
+    std::string_view text() const { return {s->text(), length}; } // Str only
+
+private:
+    static void release(StringBody* body);
+    static bool stringNumber(StringBody* body, uint32_t length, int64_t& out);
+};
+
+// std::stol over the whole of `text`: leading white space, a sign, decimal
+// digits and nothing after them, within the range of a 64-bit long.
+bool parseNumber(std::string_view text, int64_t& out);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef X86_H
+#define X86_H
+
+#include "ir.h"
+#include "regalloc.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// x86-64 general purpose registers, numbered as the encoding numbers them.
+enum class X86Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Operand of one machine instruction in the lowering below.
+struct X86Arg {
+    enum Kind : uint8_t {
+        Reg,  // value is an X86Reg
+        Slot, // spill slot `value`, 8 bytes each from %rsp
+        Imm,  // immediate
+        Var,  // the word of variable number `value`
+        Str,  // address of the rt_string of string literal Symbol `value`
+        Big,  // address of an rt_string holding the digits of integer `value`
+        Name  // address of the NUL-terminated name of variable number `value`
+    };
+    Kind kind;
+    int64_t value;
+
+    static X86Arg reg(X86Reg r) { return {Reg, static_cast<int64_t>(r)}; }
+    bool isReg() const { return kind == Reg; }
+    bool isMemory() const { return kind == Slot || kind == Var; }
+    X86Reg r() const { return static_cast<X86Reg>(value); }
+};
+
+// What the lowering writes machine code through: assembly text for the
+// native backend, bytes for the JIT. Instructions are the few the lowering
+// needs, named after their AT&T mnemonics, all 64-bit. Labels are numbers
+// handed out by label().
+class X86Emitter {
+public:
+    enum class Helper : uint8_t { Add, Sub, Mul, Div, Undefined, Print, Read, Concat }; // rt_add ... rt_concat
+    enum class Alu : uint8_t { Mov, Add, Sub, Imul, And, Or };
+    using Label = uint32_t;
+
+    virtual ~X86Emitter() = default;
+
+    // Code goes to the main body, or after it with `cold` set.
+    virtual void section(bool cold) = 0;
+    virtual Label label() = 0;
+    virtual void bind(Label l) = 0;
+    virtual void comment(const std::string&) {}
+
+    // movq; loads the address of Str, Big and Name operands (leaq), and
+    // picks movabsq for immediates that need it. At most one side is memory.
+    virtual void movq(X86Arg dst, X86Arg src) = 0;
+    // `dst op= src`, src a register or 32-bit immediate (imulq three-operand)
+    virtual void aluq(Alu op, X86Reg dst, X86Arg src) = 0;
+    virtual void testq(X86Reg a, X86Reg b) = 0;
+    virtual void testLowBit(X86Reg r) = 0; // testb $1 on the low byte of rax .. rbx
+    virtual void cmpq(X86Reg r, int32_t imm) = 0;
+    virtual void sarq1(X86Reg r) = 0;
+    virtual void cqto() = 0;
+    virtual void idivq(X86Reg r) = 0;
+    virtual void tag(X86Reg r) = 0; // r = r * 2 + 1 (leaq 1(r,r), r)
+    virtual void jmp(Label l) = 0;
+    virtual void jz(Label l) = 0;
+    virtual void jo(Label l) = 0;
+    virtual void call(Helper h) = 0;
+    virtual void pushq(X86Reg r) = 0;
+    virtual void popq(X86Reg r) = 0;
+    virtual void addRsp(int32_t bytes) = 0; // negative to reserve
+    virtual void ret() = 0;
+};
+
+// Lower `ir` to one function through `out`. Values use the word layout of
+// runtime/runtime.h, variables live in a zeroed array and temps in the
+// callee-saved registers rbx, rbp and r12-r15, which survive the calls
+// into the runtime; temps that do not fit are spilled to stack slots,
+// which instructions address directly. The function takes no arguments,
+// returns 0 and has the ABI of `main`.
+//
+// Integer arithmetic runs inline on the tagged words; strings, results
+// that overflow a word, errors and I/O call the runtime.
+// A runtime error jumps to the end of its statement, like the interpreter
+// abandoning it. Returns the variables in order of their numbers.
+std::vector<Symbol> lowerToX86(const IRProgram& ir, const RegisterAllocation& ra, X86Emitter& out);
+
+// Native backend: the lowering above as assembly for the GNU assembler
+// (AT&T syntax, System V ABI), with the program as `main`.
+class X86CodeGenerator {
+private:
+    int registers;
+    AllocationStats lastStats;
+
+public:
+    static constexpr int REGISTERS = 6;
+
+    // Temps get the first `registers` of the callee-saved registers (at
+    // most REGISTERS); fewer make more of them spill.
+    explicit X86CodeGenerator(int registers = REGISTERS);
+
+    // The assembly text of a whole program.
+    std::string generate(const IRProgram& ir, const SymbolTable& symbols);
+
+    // Register allocation of the last generate() call.
+    const AllocationStats& allocationStats() const { return lastStats; }
+};
+
+// Assemble `assembly` and link it with the runtime source at `runtime`
+// into the executable `output`, using the C compiler named by $CC (cc by
+// default). The assembly is kept next to it as `output`.s. On failure,
+// returns false with the reason in `error`.
+bool buildExecutable(const std::string& assembly, const std::string& runtime, const std::string& output,
+                     std::string& error);
+
+#endif
@@ -0,0 +1,391 @@
+#include "runtime.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define rawRead(fd, buffer, n) _read(fd, buffer, (unsigned)(n))
+#define rawWrite(fd, text, n) _write(fd, text, (unsigned)(n))
+#define isTerminal(fd) _isatty(fd)
+#else
+#include <unistd.h>
+#define rawRead(fd, buffer, n) read(fd, buffer, (size_t)(n))
+#define rawWrite(fd, text, n) write(fd, text, (size_t)(n))
+#define isTerminal(fd) isatty(fd)
+#endif
+
+/* Each thread has its own I/O state, so that a compiler running programs
+ * on several threads can give each one its own input and output. */
+#if defined(__cplusplus)
+#define RT_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define RT_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define RT_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define RT_THREAD_LOCAL __declspec(thread)
+#else
+#define RT_THREAD_LOCAL
+#endif
+
+static void outOfMemory(void) {
+    fputs("Runtime error: out of memory\n", stderr);
+    exit(1);
+}
+
+/* Strings are never freed: a program runs once, top to bottom. */
+static rt_string* newString(int64_t length) {
+    rt_string* s = (rt_string*)malloc(sizeof(rt_string) + (size_t)length + 1);
+    if (!s) outOfMemory();
+    s->length = length;
+    s->numeric = -1;
+    s->view = 0;
+    s->value = 0;
+    s->text[length] = '\0';
+    return s;
+}
+
+/* A buffer holding `used` bytes, with room for `capacity` */
+static rt_buffer* newBuffer(int64_t used, int64_t capacity) {
+    rt_buffer* b = (rt_buffer*)malloc(sizeof(rt_buffer) + (size_t)capacity);
+    if (!b) outOfMemory();
+    b->used = used;
+    b->capacity = capacity;
+    return b;
+}
+
+/* A view of the first `length` bytes of `b` */
+static int64_t newView(rt_buffer* b, int64_t length) {
+    rt_string* s = (rt_string*)malloc(sizeof(rt_string) + sizeof b);
+    if (!s) outOfMemory();
+    s->length = length;
+    s->numeric = -1;
+    s->view = 1;
+    s->value = 0;
+    memcpy(s->text, &b, sizeof b);
+    return (int64_t)(intptr_t)s;
+}
+
+static rt_buffer* bufferOf(const rt_string* s) {
+    rt_buffer* b;
+    memcpy(&b, s->text, sizeof b);
+    return b;
+}
+
+static const char* bytesOf(const rt_string* s) {
+    return s->view ? bufferOf(s)->bytes : s->text;
+}
+
+static int isInt(int64_t v) {
+    return (v & 1) != 0;
+}
+
+static int64_t toInt(int64_t v) {
+    return v >> 1;
+}
+
+/* Decimal text of n in `buffer` (24 bytes); returns its length. */
+static int64_t formatInt(int64_t n, char* buffer) {
+    char digits[20];
+    int count = 0;
+    uint64_t u = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+    do {
+        digits[count++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    int64_t length = 0;
+    if (n < 0) buffer[length++] = '-';
+    while (count > 0) buffer[length++] = digits[--count];
+    return length;
+}
+
+/* The word for integer n: immediate if it fits in 63 bits, else the digits */
+static int64_t fromInt(int64_t n) {
+    if (n >= -((int64_t)1 << 62) && n < ((int64_t)1 << 62)) return n * 2 + 1;
+    char digits[24];
+    int64_t length = formatInt(n, digits);
+    rt_string* s = newString(length);
+    memcpy(s->text, digits, (size_t)length);
+    s->numeric = 1;
+    s->value = n;
+    return (int64_t)(intptr_t)s;
+}
+
+/* std::stol over the whole text: leading white space, a sign, decimal
+ * digits and nothing after them, within the range of long. */
+static int parseNumber(const char* p, const char* end, int64_t* out) {
+    while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+    int negative = 0;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p == end || *p < '0' || *p > '9') return 0;
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    uint64_t n = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (n > (limit - digit) / 10) return 0; /* out of range */
+        n = n * 10 + digit;
+    }
+    if (p != end) return 0;
+    *out = (int64_t)(negative ? 0 - n : n);
+    return 1;
+}
+
+static int numeric(int64_t v, int64_t* out) {
+    if (isInt(v)) {
+        *out = toInt(v);
+        return 1;
+    }
+    rt_string* s = (rt_string*)(intptr_t)v;
+    if (s->numeric < 0) s->numeric = parseNumber(bytesOf(s), bytesOf(s) + s->length, &s->value);
+    *out = s->value;
+    return s->numeric;
+}
+
+/* Text of `v`: a string's own bytes, or an integer written into `buffer`. */
+static const char* text(int64_t v, char* buffer, int64_t* length) {
+    if (isInt(v)) {
+        *length = formatInt(toInt(v), buffer);
+        return buffer;
+    }
+    rt_string* s = (rt_string*)(intptr_t)v;
+    *length = s->length;
+    return bytesOf(s);
+}
+
+static void error(const char* what, int32_t line) {
+    char message[128];
+    int length = snprintf(message, sizeof message, "Runtime error: %s at line %d", what, (int)line);
+    rt_write_error(message, length);
+}
+
+int64_t rt_add(int64_t a, int64_t b) {
+    int64_t x, y;
+    if (numeric(a, &x) && numeric(b, &y)) return fromInt((int64_t)((uint64_t)x + (uint64_t)y));
+    return rt_concat(a, b);
+}
+
+int64_t rt_concat(int64_t a, int64_t b) {
+    char left[24], right[24];
+    int64_t la, lb;
+    const char* ta = text(a, left, &la);
+    const char* tb = text(b, right, &lb);
+    int64_t length = la + lb;
+
+    /* a view ending where its buffer's bytes end: append after it; tb may
+     * be in the same buffer, never past `used` */
+    rt_string* s = isInt(a) ? NULL : (rt_string*)(intptr_t)a;
+    if (s && s->view) {
+        rt_buffer* shared = bufferOf(s);
+        if (la == shared->used && length <= shared->capacity) {
+            memcpy(shared->bytes + la, tb, (size_t)lb);
+            shared->used = length;
+            return newView(shared, length);
+        }
+    }
+    /* a new buffer with room to grow, never a larger copy of the old one:
+     * other views still point into that */
+    rt_buffer* grown = newBuffer(length, length < 32 ? 32 : length * 2);
+    memcpy(grown->bytes, ta, (size_t)la);
+    memcpy(grown->bytes + la, tb, (size_t)lb);
+    return newView(grown, length);
+}
+
+int64_t rt_sub(int64_t a, int64_t b, int32_t line) {
+    int64_t x, y;
+    if (!numeric(a, &x) || !numeric(b, &y)) {
+        error("Cannot subtract non-numeric values", line);
+        return 0;
+    }
+    return fromInt((int64_t)((uint64_t)x - (uint64_t)y));
+}
+
+int64_t rt_mul(int64_t a, int64_t b, int32_t line) {
+    int64_t x, y;
+    if (!numeric(a, &x) || !numeric(b, &y)) {
+        error("Cannot multiply non-numeric values", line);
+        return 0;
+    }
+    return fromInt((int64_t)((uint64_t)x * (uint64_t)y));
+}
+
+int64_t rt_div(int64_t a, int64_t b, int32_t line) {
+    int64_t x, y;
+    if (!numeric(a, &x) || !numeric(b, &y)) {
+        error("Cannot divide non-numeric values", line);
+        return 0;
+    }
+    if (y == 0) {
+        error("Division by zero", line);
+        return 0;
+    }
+    /* INT64_MIN / -1 wraps instead of trapping */
+    if (y == -1) return fromInt((int64_t)(0 - (uint64_t)x));
+    return fromInt(x / y);
+}
+
+void rt_undefined(const char* name, int32_t line) {
+    /* names are as long as the source allows */
+    size_t size = strlen(name) + 64;
+    char* message = (char*)malloc(size);
+    if (!message) outOfMemory();
+    int length = snprintf(message, size, "Runtime error: Undefined variable '%s' at line %d", name, (int)line);
+    rt_write_error(message, length);
+    free(message);
+}
+
+void rt_print(int64_t value) {
+    char buffer[24];
+    int64_t length;
+    const char* t = text(value, buffer, &length);
+    rt_write_line(t, length);
+}
+
+int64_t rt_read(void) {
+    int64_t length = 0;
+    const char* line = rt_read_line(&length);
+    rt_string* s = newString(length);
+    if (line) memcpy(s->text, line, (size_t)length);
+    return (int64_t)(intptr_t)s;
+}
+
+/* Buffered I/O. Output waits in io.out; unread input is in[start, end). */
+static RT_THREAD_LOCAL struct {
+    char* out;
+    int64_t length, capacity;
+    int policy; /* -1 until the first line decides it */
+    int64_t threshold;
+    int registered; /* rt_flush runs at exit */
+    rt_sink sink;
+    void* sinkContext;
+
+    char* in;
+    int64_t start, end, inCapacity;
+    int ended; /* the source has no more input */
+    rt_source source;
+    void* sourceContext;
+
+    rt_sink errors;
+    void* errorsContext;
+} io = {NULL, 0, 0, -1, RT_FLUSH_THRESHOLD, 0, NULL, NULL, NULL, 0, 0, 0, 0, NULL, NULL, NULL, NULL};
+
+static void writeStdout(const char* text, int64_t length, void* context) {
+    (void)context;
+    /* whatever went through stdio first (the compiler's own listing) */
+    fflush(stdout);
+    while (length > 0) {
+        long n = (long)rawWrite(1, text, length > INT_MAX ? INT_MAX : length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        text += n;
+        length -= n;
+    }
+}
+
+static int64_t readStdin(char* buffer, int64_t capacity, void* context) {
+    (void)context;
+    for (;;) {
+        long n = (long)rawRead(0, buffer, capacity > INT_MAX ? INT_MAX : capacity);
+        if (n >= 0) return n;
+        if (errno != EINTR) return 0;
+    }
+}
+
+void rt_flush(void) {
+    if (io.length == 0) return;
+    int64_t length = io.length;
+    io.length = 0;
+    if (io.sink) io.sink(io.out, length, io.sinkContext);
+    else writeStdout(io.out, length, NULL);
+}
+
+void rt_set_flush(int policy, int64_t threshold) {
+    rt_flush();
+    io.policy = policy;
+    io.threshold = threshold > 0 ? threshold : RT_FLUSH_THRESHOLD;
+}
+
+void rt_set_output(rt_sink sink, void* context) {
+    rt_flush();
+    io.sink = sink;
+    io.sinkContext = context;
+}
+
+void rt_set_errors(rt_sink sink, void* context) {
+    io.errors = sink;
+    io.errorsContext = context;
+}
+
+void rt_write_error(const char* text, int64_t length) {
+    /* keep the order of output and errors when both go to one terminal */
+    rt_flush();
+    if (io.errors) {
+        io.errors(text, length, io.errorsContext);
+        io.errors("\n", 1, io.errorsContext);
+        return;
+    }
+    fflush(stdout);
+    fprintf(stderr, "%.*s\n", (int)length, text);
+}
+
+void rt_set_input(rt_source source, void* context) {
+    io.source = source;
+    io.sourceContext = context;
+    io.start = io.end = 0;
+    io.ended = 0;
+}
+
+void rt_write_line(const char* text, int64_t length) {
+    if (io.policy < 0) io.policy = isTerminal(1) ? RT_FLUSH_LINE : RT_FLUSH_SIZE;
+    if (!io.registered) {
+        io.registered = 1;
+        atexit(rt_flush);
+    }
+    if (io.length + length + 1 > io.capacity) {
+        int64_t capacity = io.capacity ? io.capacity * 2 : 4096;
+        while (capacity < io.length + length + 1) capacity *= 2;
+        char* grown = (char*)realloc(io.out, (size_t)capacity);
+        if (!grown) outOfMemory();
+        io.out = grown;
+        io.capacity = capacity;
+    }
+    memcpy(io.out + io.length, text, (size_t)length);
+    io.out[io.length + length] = '\n';
+    io.length += length + 1;
+    if (io.policy == RT_FLUSH_LINE || (io.policy == RT_FLUSH_SIZE && io.length >= io.threshold)) rt_flush();
+}
+
+const char* rt_read_line(int64_t* length) {
+    int64_t scanned = io.start; /* no newline in in[start, scanned) */
+    for (;;) {
+        char* newline = scanned < io.end ? (char*)memchr(io.in + scanned, '\n', (size_t)(io.end - scanned)) : NULL;
+        if (newline || io.ended) {
+            if (!newline && io.start == io.end) return NULL;
+            const char* line = io.in + io.start;
+            int64_t end = newline ? newline - io.in : io.end;
+            *length = end - io.start;
+            io.start = newline ? end + 1 : end;
+            return line;
+        }
+
+        /* keep the partial line at the front and read another block */
+        scanned = io.end - io.start;
+        memmove(io.in, io.in + io.start, (size_t)scanned);
+        io.start = 0;
+        io.end = scanned;
+        if (io.inCapacity - io.end < RT_FLUSH_THRESHOLD / 2) {
+            int64_t capacity = io.inCapacity ? io.inCapacity * 2 : RT_FLUSH_THRESHOLD;
+            char* grown = (char*)realloc(io.in, (size_t)capacity);
+            if (!grown) outOfMemory();
+            io.in = grown;
+            io.inCapacity = capacity;
+        }
+        /* the program is about to wait: what it printed must be seen */
+        rt_flush();
+        int64_t n = io.source ? io.source(io.in + io.end, io.inCapacity - io.end, io.sourceContext)
+                              : readStdin(io.in + io.end, io.inCapacity - io.end, NULL);
+        if (n <= 0) io.ended = 1;
+        else io.end += n;
+    }
+}
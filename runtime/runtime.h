@@ -0,0 +1,112 @@
+#ifndef MINI_RUNTIME_H
+#define MINI_RUNTIME_H
+
+/* Runtime of natively compiled programs. Generated code keeps every value
+ * in one 64-bit word:
+ *
+ *   0            no value (a variable that was never assigned)
+ *   odd          an integer n, as n * 2 + 1 (n fits in 63 bits)
+ *   even, not 0  a pointer to an rt_string
+ *
+ * Integers are what arithmetic produces, so the common case never leaves
+ * generated code. Everything else - concatenation, strings that hold
+ * numbers, errors and I/O - calls the functions below. Values follow the
+ * interpreter: integers are 64 bits and wrap around, and a string is a
+ * number if std::stol reads all of it. An integer too wide for a word is
+ * kept as a string of its digits, which behaves the same.
+ *
+ * This file is C and C++ at once: it is compiled with the generated
+ * assembly, and can be linked into the compiler itself. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A string is its bytes (literals, input lines, wide integers), or, made by
+ * concatenation, a view of the first `length` bytes of a growing buffer
+ * that other, shorter views share. Appending to the longest view writes
+ * after it in place, so building a string piece by piece takes time linear
+ * in its length; the bytes a view sees never change. */
+typedef struct rt_string {
+    int64_t length;
+    int32_t numeric; /* 1 or 0, -1 until first asked */
+    int32_t view;    /* 0: the bytes follow; 1: text holds an rt_buffer* */
+    int64_t value;   /* the number, if numeric */
+    char text[];     /* length bytes, then a NUL (view 0) */
+} rt_string;
+
+typedef struct rt_buffer {
+    int64_t used, capacity;
+    char bytes[];
+} rt_buffer;
+
+/* Arithmetic when an operand is not an immediate integer. "+" on anything
+ * but two numbers concatenates; the others report an error at `line` on
+ * stderr and return 0, and the caller abandons the statement. Division
+ * also comes here for a divisor of 0 or -1, and the others when the
+ * result does not fit in a word. */
+int64_t rt_add(int64_t a, int64_t b);
+int64_t rt_sub(int64_t a, int64_t b, int32_t line);
+int64_t rt_mul(int64_t a, int64_t b, int32_t line);
+int64_t rt_div(int64_t a, int64_t b, int32_t line);
+
+/* "+" where an operand was proved never to be a number: concatenates
+ * without looking at either for one. */
+int64_t rt_concat(int64_t a, int64_t b);
+
+/* "Runtime error: Undefined variable 'name' at line N" */
+void rt_undefined(const char* name, int32_t line);
+
+/* cout(value): the value and a newline */
+void rt_print(int64_t value);
+/* cin(x): the next input line without its newline, "" at end of input */
+int64_t rt_read(void);
+
+/* Buffered I/O, shared by native programs, the JIT and the interpreter.
+ * Output collects in one buffer and is written out by the flush policy;
+ * input is read in large blocks and split into lines here. Pending output
+ * is always written before an error is reported and before the program
+ * waits for input, so a prompt is seen and the order of output and errors
+ * is kept. All of this state, the policy and the sinks included, belongs
+ * to the calling thread; only the main thread's output is flushed at
+ * exit. */
+enum {
+    RT_FLUSH_EXIT, /* only at exit (or when rt_flush is called) */
+    RT_FLUSH_LINE, /* after every line */
+    RT_FLUSH_SIZE  /* whenever `threshold` bytes are waiting */
+};
+#define RT_FLUSH_THRESHOLD 65536
+
+/* The default is RT_FLUSH_LINE when standard output is a terminal and
+ * RT_FLUSH_SIZE with RT_FLUSH_THRESHOLD bytes otherwise. */
+void rt_set_flush(int policy, int64_t threshold);
+
+/* Where output goes and input comes from; NULL restores standard output
+ * or standard input. A source returns the number of bytes it put in
+ * `buffer`, 0 at end of input. */
+typedef void (*rt_sink)(const char* text, int64_t length, void* context);
+typedef int64_t (*rt_source)(char* buffer, int64_t capacity, void* context);
+void rt_set_output(rt_sink sink, void* context);
+void rt_set_input(rt_source source, void* context);
+/* Where error messages go, each followed by a newline; NULL restores
+ * standard error. */
+void rt_set_errors(rt_sink sink, void* context);
+
+/* `length` bytes of text, then a newline */
+void rt_write_line(const char* text, int64_t length);
+/* The next input line without its newline, valid until the next call;
+ * NULL at end of input. */
+const char* rt_read_line(int64_t* length);
+/* Report an error: everything pending is written out, then `length`
+ * bytes of text and a newline go to the error sink. */
+void rt_write_error(const char* text, int64_t length);
+/* Write out everything pending. */
+void rt_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
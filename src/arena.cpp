@@ -0,0 +1,54 @@
+#include "arena.h"
+#include <cstdlib>
+
+Arena::Arena(size_t firstChunkSize)
+    : head(nullptr), cur(nullptr), end(nullptr), nextChunkSize(firstChunkSize), used(0) {}
+
+Arena::~Arena() {
+    reset();
+}
+
+void Arena::grow(size_t minBytes) {
+    size_t size = nextChunkSize;
+    while (size < minBytes) size *= 2;
+    // cap the geometric growth so a huge AST does not over-reserve
+    if (nextChunkSize < 16 * 1024 * 1024) nextChunkSize *= 2;
+
+    void* mem = std::malloc(sizeof(Chunk) + size);
+    if (!mem) throw std::bad_alloc();
+    Chunk* chunk = static_cast<Chunk*>(mem);
+    chunk->next = head;
+    chunk->size = size;
+    head = chunk;
+    cur = reinterpret_cast<char*>(chunk + 1);
+    end = cur + size;
+}
+
+void Arena::reset() {
+    while (head) {
+        Chunk* next = head->next;
+        std::free(head);
+        head = next;
+    }
+    cur = end = nullptr;
+    used = 0;
+}
+
+void Arena::adopt(Arena& other) {
+    if (!other.head) return;
+    // splice other's chunks behind our current one so we keep bumping into it
+    Chunk* tail = other.head;
+    while (tail->next) tail = tail->next;
+    if (head) {
+        tail->next = head->next;
+        head->next = other.head;
+    } else {
+        head = other.head;
+        cur = other.cur;
+        end = other.end;
+    }
+    used += other.used;
+    other.head = nullptr;
+    other.cur = other.end = nullptr;
+    other.used = 0;
+}
@@ -0,0 +1,196 @@
+#include "batch.h"
+#include "runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// What one file wrote to its two streams, in the order it was written
+class Capture {
+private:
+    struct Piece {
+        bool error; // written to err
+        std::string text;
+    };
+    std::vector<Piece> pieces;
+
+    // appends everything written through it to the capture, unbuffered
+    class Buffer : public std::streambuf {
+    private:
+        Capture& capture;
+        bool error;
+
+    protected:
+        std::streamsize xsputn(const char* text, std::streamsize length) override {
+            capture.append(error, text, static_cast<size_t>(length));
+            return length;
+        }
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+            char ch = traits_type::to_char_type(c);
+            capture.append(error, &ch, 1);
+            return c;
+        }
+
+    public:
+        Buffer(Capture& capture, bool error) : capture(capture), error(error) {}
+    };
+    Buffer outBuffer{*this, false};
+    Buffer errBuffer{*this, true};
+
+public:
+    std::ostream out{&outBuffer};
+    std::ostream err{&errBuffer};
+
+    void append(bool error, const char* text, size_t length) {
+        if (pieces.empty() || pieces.back().error != error) pieces.push_back({error, std::string()});
+        pieces.back().text.append(text, length);
+    }
+
+    // replay it; `out` is flushed before every error, as it would be on a
+    // terminal
+    void writeTo(std::ostream& toOut, std::ostream& toErr) const {
+        for (const Piece& piece : pieces) {
+            if (!piece.error) {
+                toOut << piece.text;
+                continue;
+            }
+            toOut.flush();
+            toErr << piece.text;
+            toErr.flush();
+        }
+    }
+};
+
+// a program's input, served from memory
+struct Input {
+    std::string text;
+    size_t at = 0;
+};
+
+int64_t serve(char* buffer, int64_t capacity, void* context) {
+    Input& input = *static_cast<Input*>(context);
+    size_t n = std::min(static_cast<size_t>(capacity), input.text.size() - input.at);
+    std::copy_n(input.text.data() + input.at, n, buffer);
+    input.at += n;
+    return static_cast<int64_t>(n);
+}
+
+void collect(const char* text, int64_t length, void* stream) {
+    static_cast<std::ostream*>(stream)->write(text, static_cast<std::streamsize>(length));
+}
+
+// compile one file with the runtime of this thread pointed at `capture`
+int compileCaptured(const std::string& file, const BatchCompile& compile, Capture& capture) {
+    Input input;
+    std::ifstream in(fs::path(file).replace_extension(".in"), std::ios::binary);
+    if (in) {
+        std::ostringstream text;
+        text << in.rdbuf();
+        input.text = text.str();
+    }
+
+    rt_set_output(collect, &capture.out);
+    rt_set_errors(collect, &capture.err);
+    rt_set_input(serve, &input);
+    // the capture is in memory; nothing is gained by writing it in pieces
+    rt_set_flush(RT_FLUSH_EXIT, 0);
+
+    int status;
+    try {
+        status = compile(file, capture.out, capture.err);
+    } catch (const std::exception& e) {
+        capture.err << "Error while compiling " << file << ": " << e.what() << "\n";
+        status = 1;
+    } catch (...) {
+        capture.err << "Error while compiling " << file << "\n";
+        status = 1;
+    }
+
+    rt_set_output(nullptr, nullptr); // after writing out what is pending
+    rt_set_errors(nullptr, nullptr);
+    rt_set_input(nullptr, nullptr);
+    return status;
+}
+
+bool collectInput(const std::string& input, bool listed, std::vector<std::string>& files, std::ostream& diag) {
+    if (!listed && input.size() > 1 && input[0] == '@') {
+        std::ifstream list(input.substr(1));
+        if (!list) {
+            diag << "Cannot open file list: " << input.substr(1) << "\n";
+            return false;
+        }
+        bool ok = true;
+        for (std::string line; std::getline(list, line);) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) ok = collectInput(line, true, files, diag) && ok;
+        }
+        return ok;
+    }
+
+    std::error_code ec;
+    if (!fs::is_directory(input, ec)) {
+        files.push_back(input);
+        return true;
+    }
+    // directory_iterator's order is unspecified
+    std::vector<std::string> found;
+    for (fs::directory_iterator it(input, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".txt") found.push_back(it->path().string());
+    }
+    if (ec) {
+        diag << "Cannot read directory: " << input << "\n";
+        return false;
+    }
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+    return true;
+}
+
+}
+
+bool collectSources(const std::vector<std::string>& inputs, std::vector<std::string>& files, std::ostream& diag) {
+    bool ok = true;
+    for (const auto& input : inputs) ok = collectInput(input, false, files, diag) && ok;
+    return ok;
+}
+
+BatchSummary compileBatch(const std::vector<std::string>& files, ThreadPool& pool, const BatchCompile& compile,
+                          std::ostream& out, std::ostream& err) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Capture>> captures(files.size());
+    std::vector<int> status(files.size(), 0);
+
+    // captures[written] is the next one due; the thread that completes the
+    // run of finished files before it writes them out
+    std::mutex mutex;
+    size_t written = 0;
+    pool.parallelFor(files.size(), [&](size_t i) {
+        auto capture = std::make_unique<Capture>();
+        status[i] = compileCaptured(files[i], compile, *capture);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        captures[i] = std::move(capture);
+        for (; written < captures.size() && captures[written]; ++written) {
+            captures[written]->writeTo(out, err);
+            captures[written].reset();
+        }
+    });
+    out.flush();
+
+    BatchSummary summary;
+    summary.files = files.size();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (status[i] != 0) summary.failed.push_back(files[i]);
+    }
+    summary.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
@@ -0,0 +1,421 @@
+#include "bytecode.h"
+#include "ssa.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+const char* bcOpName(BcOp op) {
+    static const char* const NAMES[] = {
+#define BYTECODE_NAME(name) #name,
+        BYTECODE_OPS(BYTECODE_NAME)
+#undef BYTECODE_NAME
+    };
+    return NAMES[static_cast<int>(op)];
+}
+
+namespace {
+
+// While compiling, a register number carries its class in the top bits;
+// the final layout is only known once every variable, constant and temp
+// has been counted.
+const uint32_t VAR = 0u << 30, CONSTANT = 1u << 30, TEMP = 2u << 30, CLASS = 3u << 30;
+
+bool isArithmetic(BcOp op) {
+    return op >= BcOp::Add && op <= BcOp::Div;
+}
+
+BcOp arithmetic(char op) {
+    switch (op) {
+        case '+': return BcOp::Add;
+        case '-': return BcOp::Sub;
+        case '*': return BcOp::Mul;
+        default: return BcOp::Div;
+    }
+}
+// Typed int ops run as the untyped ones: their int fast path is the first
+// thing tried, and they keep the fused and immediate forms.
+BcOp arithmetic(IROp op) {
+    if (op == IROp::Concat) return BcOp::Concat;
+    op = untypedOp(op);
+    return static_cast<BcOp>(static_cast<int>(BcOp::Add) + static_cast<int>(op) - static_cast<int>(IROp::Add));
+}
+
+// Which operands of `op` are registers: a, b, c, d
+void registerOperands(BcOp op, bool (&used)[4]) {
+    used[0] = op != BcOp::Halt;
+    used[1] = op == BcOp::Move || isArithmetic(op) || (op >= BcOp::AddK && op <= BcOp::Concat);
+    used[2] = isArithmetic(op) || (op >= BcOp::AddAdd && op <= BcOp::Concat);
+    used[3] = op >= BcOp::AddAdd && op <= BcOp::DivDiv;
+}
+
+// Fuse the code of one statement, from `from` on: an operation whose temp
+// result is the left operand of the next one, and read nowhere else
+// (`singleUse(i)` for instruction i), becomes a single AddMul-style
+// instruction, and what is left with an integer constant on the right
+// takes it as an immediate.
+template <class SingleUse>
+void superinstructions(Bytecode& bc, size_t from, SingleUse singleUse) {
+    size_t out = from;
+    for (size_t i = from; i < bc.code.size(); ++i) {
+        BcInstr ins = bc.code[i];
+        int32_t line = bc.lines[i];
+        if (isArithmetic(ins.op)) {
+            const BcInstr* next = i + 1 < bc.code.size() ? &bc.code[i + 1] : nullptr;
+            if (next && isArithmetic(next->op) && (ins.a & CLASS) == TEMP && next->b == ins.a &&
+                next->c != ins.a && bc.lines[i + 1] == line && singleUse(i)) {
+                int first = static_cast<int>(ins.op) - static_cast<int>(BcOp::Add);
+                int second = static_cast<int>(next->op) - static_cast<int>(BcOp::Add);
+                ins = {static_cast<BcOp>(static_cast<int>(BcOp::AddAdd) + first * 4 + second), next->a, ins.b, ins.c,
+                       next->c};
+                ++i;
+            } else if ((ins.c & CLASS) == CONSTANT) {
+                const Value& k = bc.constants[ins.c & ~CLASS];
+                // dividing by 0 stays on the checked path
+                if (k.kind == Value::Kind::Int && k.i == static_cast<int32_t>(k.i) &&
+                    !(ins.op == BcOp::Div && k.i == 0)) {
+                    ins.op = static_cast<BcOp>(static_cast<int>(ins.op) - static_cast<int>(BcOp::Add) +
+                                               static_cast<int>(BcOp::AddK));
+                    ins.c = static_cast<uint32_t>(k.i);
+                }
+            }
+        }
+        bc.code[out] = ins;
+        bc.lines[out] = line;
+        ++out;
+    }
+    bc.code.resize(out);
+    bc.lines.resize(out);
+}
+
+// Give every register its final number: variables, constants, temps.
+void layout(Bytecode& bc, uint32_t temps) {
+    uint32_t base[3] = {0, static_cast<uint32_t>(bc.variables.size()),
+                        static_cast<uint32_t>(bc.variables.size() + bc.constants.size())};
+    bc.registers = base[2] + temps;
+    for (BcInstr& ins : bc.code) {
+        bool used[4];
+        registerOperands(ins.op, used);
+        uint32_t* fields[4] = {&ins.a, &ins.b, &ins.c, &ins.d};
+        for (int k = 0; k < 4; ++k) {
+            if (used[k]) *fields[k] = base[*fields[k] >> 30] + (*fields[k] & ~CLASS);
+        }
+    }
+}
+
+// What both compilers share: the program being built and its constants,
+// each loaded once however often it is used.
+class CompilerBase {
+protected:
+    const SymbolTable& symbols;
+    Bytecode bc;
+    std::vector<uint32_t> stringConstant; // per Symbol, or UINT32_MAX
+    std::unordered_map<int64_t, uint32_t> intConstant;
+
+    explicit CompilerBase(const SymbolTable& symbols)
+        : symbols(symbols), stringConstant(symbols.size(), UINT32_MAX) {}
+
+    uint32_t constant(Value v) {
+        bc.constants.push_back(std::move(v));
+        return CONSTANT | static_cast<uint32_t>(bc.constants.size() - 1);
+    }
+    uint32_t number(int64_t n) {
+        auto [it, fresh] = intConstant.try_emplace(n, 0);
+        if (fresh) it->second = constant(Value::integer(n));
+        return it->second;
+    }
+    uint32_t string(Symbol text) {
+        if (stringConstant[text] == UINT32_MAX) stringConstant[text] = constant(Value::string(symbols.name(text)));
+        return stringConstant[text];
+    }
+    void emit(BcOp op, int32_t line, uint32_t a, uint32_t b = 0, uint32_t c = 0, uint32_t d = 0) {
+        bc.code.push_back({op, a, b, c, d});
+        bc.lines.push_back(line);
+    }
+};
+
+class BytecodeCompiler : CompilerBase {
+private:
+    const FlatAST& ast;
+    const Resolution& slots;
+    uint32_t temps = 0, maxTemps = 0;
+    std::vector<uint32_t> operands; // registers of finished sub-expressions
+    std::vector<bool> checkFirst;   // per node: a variable read long before its use
+
+    uint32_t variable(Symbol name) { return VAR | slots.slotOf[name]; }
+    uint32_t pop() {
+        uint32_t r = operands.back();
+        operands.pop_back();
+        if ((r & CLASS) == TEMP) --temps;
+        return r;
+    }
+    uint32_t temp() {
+        maxTemps = std::max(maxTemps, temps + 1);
+        return TEMP | temps++;
+    }
+
+    void statement(size_t s);
+
+public:
+    BytecodeCompiler(const FlatAST& ast, const SymbolTable& symbols, const Resolution& slots)
+        : CompilerBase(symbols), ast(ast), slots(slots), checkFirst(ast.size(), false) {}
+
+    Bytecode run() {
+        bc.variables = slots.slots;
+        for (size_t s = 0; s < ast.statements.size(); ++s) {
+            size_t from = bc.code.size();
+            bc.statements.push_back(static_cast<uint32_t>(from));
+            statement(s);
+            // an expression's temps are each read exactly once
+            superinstructions(bc, from, [](size_t) { return true; });
+        }
+        bc.statements.push_back(static_cast<uint32_t>(bc.code.size()));
+        emit(BcOp::Halt, 0, 0);
+        layout(bc, maxTemps);
+        return std::move(bc);
+    }
+};
+
+void BytecodeCompiler::statement(size_t s) {
+    NodeIndex root = ast.statements[s];
+    NodeIndex first = ast.begin(s);
+
+    // a variable on the left of an operator is read before the right side
+    // runs; if that side can fail, the read has to be checked up front,
+    // unless the variable is sure to be assigned by then
+    for (NodeIndex i = first; i < root; ++i) {
+        if (ast.kind[i] == NodeKind::BinOp && ast.kind[ast.lhs[i]] == NodeKind::Variable &&
+            ast.kind[ast.rhs[i]] == NodeKind::BinOp && !slots.assigned[ast.lhs[i]]) {
+            checkFirst[ast.lhs[i]] = true;
+        }
+    }
+
+    // the value of an assignment is computed straight into the variable
+    NodeIndex value = ast.kind[root] == NodeKind::Assign ? ast.lhs[root] : NO_NODE;
+    for (NodeIndex i = first; i <= root; ++i) {
+        int32_t line = ast.line[i];
+        Symbol name = static_cast<Symbol>(ast.payload[i]);
+        switch (ast.kind[i]) {
+            case NodeKind::Number:
+                operands.push_back(number(ast.payload[i]));
+                break;
+            case NodeKind::String:
+                operands.push_back(string(name));
+                break;
+            case NodeKind::Variable:
+                operands.push_back(variable(name));
+                if (checkFirst[i]) emit(BcOp::Check, line, operands.back());
+                break;
+            case NodeKind::BinOp: {
+                uint32_t right = pop(), left = pop();
+                uint32_t dst = i == value ? variable(static_cast<Symbol>(ast.payload[root])) : temp();
+                char op = static_cast<char>(ast.payload[i]);
+                // "+" giving a String concatenates without looking for numbers
+                bool concat = op == '+' && slots.types[i] == ValueType::String;
+                emit(concat ? BcOp::Concat : arithmetic(op), line, dst, left, right);
+                operands.push_back(dst);
+                break;
+            }
+            case NodeKind::Assign: {
+                uint32_t target = variable(name);
+                uint32_t v = pop();
+                if (v != target) emit(BcOp::Move, line, target, v);
+                else if (ast.kind[ast.lhs[i]] == NodeKind::Variable && !slots.assigned[ast.lhs[i]])
+                    emit(BcOp::Check, line, target); // x = x
+                break;
+            }
+            case NodeKind::Cin:
+                emit(BcOp::Read, line, variable(name));
+                break;
+            case NodeKind::Cout:
+                emit(BcOp::Print, line, pop());
+                break;
+        }
+    }
+    operands.clear();
+    temps = 0;
+}
+
+// Optimized IR: temps are assigned once but may be read any number of
+// times, in later statements too. A temp holds a register from its
+// definition to its last read; the register is then free for the next one.
+// Two kinds of temps need no register at all: a LOAD read only within its
+// statement reads the variable's register (no STORE can come between),
+// and a value whose one reader is the STORE right after it is computed
+// straight into the variable.
+class IRBytecodeCompiler : CompilerBase {
+private:
+    const IRProgram& ir;
+    std::vector<uint32_t> varRegister;     // per Symbol, or UINT32_MAX
+    std::vector<uint32_t> tempRegister;    // per temp: a temp register, or the variable a LOAD stands for
+    std::vector<uint32_t> reads, lastRead; // per temp
+    std::vector<uint32_t> statement;       // per instruction: index of its statement
+    std::vector<uint32_t> freeTemps;
+    uint32_t maxTemps = 0;
+    std::vector<bool> once; // per instruction of the statement: its temp is read by nothing but the next one
+
+    uint32_t variable(Symbol name) {
+        if (name >= varRegister.size()) varRegister.resize(name + 1, UINT32_MAX);
+        if (varRegister[name] == UINT32_MAX) {
+            varRegister[name] = static_cast<uint32_t>(bc.variables.size());
+            bc.variables.push_back(name);
+        }
+        return VAR | varRegister[name];
+    }
+    uint32_t operand(Operand o) {
+        switch (o.kind) {
+            case OperandKind::Temp: return tempRegister[o.id];
+            case OperandKind::Var: return variable(o.id);
+            case OperandKind::Int: return number(ir.intValue(o));
+            default: return string(o.id);
+        }
+    }
+    uint32_t define(uint32_t t) {
+        uint32_t r = maxTemps;
+        if (freeTemps.empty()) ++maxTemps;
+        else r = freeTemps.back(), freeTemps.pop_back();
+        return tempRegister[t] = TEMP | r;
+    }
+    // free the register of temp operand `o` if instruction idx reads it last
+    void release(Operand o, size_t idx) {
+        if (o.kind == OperandKind::Temp && lastRead[o.id] == idx && (tempRegister[o.id] & CLASS) == TEMP)
+            freeTemps.push_back(tempRegister[o.id] & ~CLASS);
+    }
+    size_t next(size_t idx) const {
+        do ++idx;
+        while (idx < ir.code.size() && ir.code[idx].op == IROp::Nop);
+        return idx;
+    }
+    // Whether the instruction after LOAD idx reads its temp before anything
+    // else that can fail, so a variable never assigned is reported in the
+    // same place without a check of its own.
+    bool readsNext(size_t idx) const {
+        size_t n = next(idx);
+        if (n == ir.code.size()) return false;
+        Operand t = ir.code[idx].result(), a = ir.code[n].arg1(), b = ir.code[n].arg2();
+        return a == t || (b == t && a.kind != OperandKind::Var);
+    }
+    void emit(BcOp op, size_t idx, uint32_t a, uint32_t b = 0, uint32_t c = 0) {
+        CompilerBase::emit(op, static_cast<int32_t>(ir.line(idx)), a, b, c);
+        const IRInstruction& ins = ir.code[idx];
+        once.push_back(ins.kinds[2] == OperandKind::Temp && reads[ins.ids[2]] == 1);
+    }
+
+public:
+    IRBytecodeCompiler(const IRProgram& ir, const SymbolTable& symbols)
+        : CompilerBase(symbols), ir(ir), tempRegister(ir.temps + 1), reads(ir.temps + 1, 0),
+          lastRead(ir.temps + 1, UINT32_MAX), statement(ir.code.size()) {
+        uint32_t s = 0;
+        for (size_t idx = 0; idx < ir.code.size(); ++idx) {
+            const IRInstruction& ins = ir.code[idx];
+            for (int k = 0; k < 2; ++k) {
+                if (ins.kinds[k] == OperandKind::Temp && (k == 0 || ins.arg2() != ins.arg1())) {
+                    ++reads[ins.ids[k]];
+                    lastRead[ins.ids[k]] = static_cast<uint32_t>(idx);
+                }
+            }
+            statement[idx] = s;
+            if (endsStatement(ins.op)) ++s;
+        }
+    }
+
+    Bytecode run();
+};
+
+Bytecode IRBytecodeCompiler::run() {
+    size_t from = 0;
+    bool open = false;           // the current statement has instructions
+    size_t stored = SIZE_MAX;    // a STORE already done by the instruction before it
+    auto close = [&] {
+        superinstructions(bc, from, [&](size_t i) { return static_cast<bool>(once[i - from]); });
+        once.clear();
+        open = false;
+    };
+    for (size_t idx = 0; idx < ir.code.size(); ++idx) {
+        const IRInstruction& ins = ir.code[idx];
+        if (ins.op == IROp::Nop) continue;
+        if (!open) {
+            from = bc.code.size();
+            bc.statements.push_back(static_cast<uint32_t>(from));
+            open = true;
+        }
+        if (idx == stored) {
+            close();
+            continue;
+        }
+        Operand a = ins.arg1(), b = ins.arg2();
+        uint32_t t = ins.ids[2];
+        bool unread = ins.kinds[2] == OperandKind::Temp && reads[t] == 0;
+        // the one reader is the STORE right after: write the variable itself
+        size_t n = next(idx);
+        bool forward = ins.kinds[2] == OperandKind::Temp && reads[t] == 1 && n < ir.code.size() &&
+                       ir.code[n].op == IROp::Store && ir.code[n].arg1() == ins.result();
+        auto result = [&] {
+            if (!forward) return define(t);
+            stored = n;
+            return variable(ir.code[n].ids[2]);
+        };
+        switch (ins.op) {
+            case IROp::Load:
+                if (!unread && statement[lastRead[t]] == statement[idx]) {
+                    tempRegister[t] = variable(a.id);
+                    if (!readsNext(idx)) emit(BcOp::Check, idx, tempRegister[t]);
+                    break;
+                }
+                [[fallthrough]];
+            case IROp::Mov: {
+                uint32_t source = operand(a);
+                release(a, idx);
+                // a load of a never assigned variable fails even if unread
+                if (!unread) emit(BcOp::Move, idx, result(), source);
+                else if (ins.op == IROp::Load) emit(BcOp::Check, idx, source);
+                break;
+            }
+            case IROp::Add:
+            case IROp::Sub:
+            case IROp::Mul:
+            case IROp::Div:
+            case IROp::IAdd:
+            case IROp::ISub:
+            case IROp::IMul:
+            case IROp::IDiv:
+            case IROp::Concat: {
+                uint32_t left = operand(a), right = operand(b);
+                release(a, idx);
+                if (b != a) release(b, idx);
+                uint32_t dst = result();
+                emit(arithmetic(ins.op), idx, dst, left, right);
+                if (unread) freeTemps.push_back(dst & ~CLASS);
+                break;
+            }
+            case IROp::Store:
+                emit(BcOp::Move, idx, variable(t), operand(a));
+                release(a, idx);
+                break;
+            case IROp::Print:
+                emit(BcOp::Print, idx, operand(a));
+                release(a, idx);
+                break;
+            case IROp::Read:
+                emit(BcOp::Read, idx, variable(t));
+                break;
+            case IROp::Nop:
+                break;
+        }
+        if (endsStatement(ins.op)) close();
+    }
+    if (open) close();
+    bc.statements.push_back(static_cast<uint32_t>(bc.code.size()));
+    CompilerBase::emit(BcOp::Halt, 0, 0);
+    layout(bc, maxTemps);
+    return std::move(bc);
+}
+
+}
+
+Bytecode compileBytecode(const FlatAST& ast, const SymbolTable& symbols, const Resolution& slots) {
+    return BytecodeCompiler(ast, symbols, slots).run();
+}
+
+Bytecode compileBytecode(const IRProgram& ir, const SymbolTable& symbols) {
+    return IRBytecodeCompiler(ir, symbols).run();
+}
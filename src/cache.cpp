@@ -0,0 +1,295 @@
+#include "cache.h"
+#include "hash.h"
+#include "source.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+namespace fs = std::filesystem;
+
+// Part of every key. The number is bumped by every change to the entry
+// layout or to how a source is lowered (IR ops, passes, diagnostics), so
+// entries written by an older compiler are never reused; builds of the same
+// source share entries, on any machine. A build may also key on its
+// revision with -DMINI_COMPILER_REVISION='"..."'.
+#ifndef MINI_COMPILER_REVISION
+#define MINI_COMPILER_REVISION ""
+#endif
+static const char COMPILER_VERSION[] = "mini-compiler cache 4 " MINI_COMPILER_REVISION;
+static const char MAGIC[8] = {'M', 'C', 'C', 'A', 'C', 'H', 'E', '1'};
+static const char EXTENSION[] = ".mcc";
+
+namespace {
+
+// Appends fixed-size values and arrays, padding every array to 8 bytes so
+// the file could also be read in place.
+class Writer {
+public:
+    std::string bytes;
+
+    template <typename T>
+    void value(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        bytes.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template <typename T>
+    void array(const std::vector<T>& v) {
+        value<uint64_t>(v.size());
+        if (!v.empty()) bytes.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+        bytes.append((8 - bytes.size() % 8) % 8, '\0');
+    }
+
+    void text(std::string_view s) {
+        value<uint64_t>(s.size());
+        bytes.append(s.data(), s.size());
+        bytes.append((8 - bytes.size() % 8) % 8, '\0');
+    }
+};
+
+// Reads what Writer wrote; any overrun marks the whole entry bad.
+class Reader {
+private:
+    std::string_view bytes;
+    size_t pos = 0;
+
+    void align() { pos += (8 - pos % 8) % 8; }
+
+public:
+    bool ok = true;
+
+    explicit Reader(std::string_view bytes) : bytes(bytes) {}
+
+    template <typename T>
+    T value() {
+        T v{};
+        if (!ok || bytes.size() - pos < sizeof(T)) {
+            ok = false;
+            return v;
+        }
+        std::memcpy(&v, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    template <typename T>
+    void array(std::vector<T>& v) {
+        uint64_t n = value<uint64_t>();
+        if (!ok || n > (bytes.size() - pos) / sizeof(T)) {
+            ok = false;
+            return;
+        }
+        v.resize(n);
+        if (n) std::memcpy(static_cast<void*>(v.data()), bytes.data() + pos, n * sizeof(T));
+        pos += n * sizeof(T);
+        align();
+    }
+
+    std::string text() {
+        uint64_t n = value<uint64_t>();
+        if (!ok || n > bytes.size() - pos) {
+            ok = false;
+            return std::string();
+        }
+        std::string s(bytes.data() + pos, n);
+        pos += n;
+        align();
+        return s;
+    }
+
+    bool atEnd() const { return pos >= bytes.size(); }
+};
+
+}
+
+static void writeProgram(Writer& w, const IRProgram& ir) {
+    w.array(ir.code);
+    w.array(ir.lines);
+    w.array(ir.ints);
+    w.value<uint64_t>(ir.temps);
+    w.value<uint64_t>(ir.notes.size());
+    for (const IRNote& n : ir.notes) {
+        w.value<uint64_t>(n.before);
+        w.text(n.text);
+    }
+}
+
+static void readProgram(Reader& r, IRProgram& ir) {
+    r.array(ir.code);
+    r.array(ir.lines);
+    r.array(ir.ints);
+    ir.temps = static_cast<uint32_t>(r.value<uint64_t>());
+    uint64_t notes = r.value<uint64_t>();
+    ir.notes.clear();
+    for (uint64_t i = 0; r.ok && i < notes; ++i) {
+        uint32_t before = static_cast<uint32_t>(r.value<uint64_t>());
+        ir.notes.push_back({before, r.text()});
+    }
+}
+
+std::string CompileCache::Key::hex() const {
+    char buf[33];
+    std::snprintf(buf, sizeof buf, "%016llx%016llx", static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+    return buf;
+}
+
+CompileCache::CompileCache(std::string dir, uint64_t maxBytes) : dir(std::move(dir)), maxBytes(maxBytes) {
+    std::error_code ec;
+    fs::create_directories(this->dir, ec);
+}
+
+CompileCache::Key CompileCache::keyFor(std::string_view source, uint64_t options) {
+    uint64_t version = hashBytes(COMPILER_VERSION, sizeof COMPILER_VERSION - 1);
+    uint64_t seed = mix64(version ^ mix64(options + 1));
+    // two independently seeded hashes: 128 bits make accidental collisions
+    // between cached programs negligible
+    return Key{hashBytes(source, seed), hashBytes(source, mix64(seed + 0x9e3779b97f4a7c15ULL)), source.size()};
+}
+
+std::string CompileCache::pathFor(const Key& key) const {
+    return (fs::path(dir) / (key.hex() + EXTENSION)).string();
+}
+
+bool CompileCache::load(const Key& key, CacheEntry& entry) {
+    std::string path = pathFor(key);
+    SourceFile file;
+    std::error_code ec;
+    if (!fs::exists(path, ec) || !file.open(path)) {
+        count(&Stats::misses);
+        return false;
+    }
+
+    // header: magic, key, source size, checksum of the rest
+    std::string_view bytes = file.text();
+    Reader header(bytes);
+    char magic[8];
+    for (char& c : magic) c = header.value<char>();
+    uint64_t hi = header.value<uint64_t>(), lo = header.value<uint64_t>();
+    uint64_t size = header.value<uint64_t>(), checksum = header.value<uint64_t>();
+    const size_t headerSize = sizeof MAGIC + 4 * sizeof(uint64_t);
+    bool ok = header.ok && std::memcmp(magic, MAGIC, sizeof MAGIC) == 0 && hi == key.hi && lo == key.lo &&
+              size == key.sourceSize && hashBytes(bytes.substr(headerSize)) == checksum;
+
+    if (ok) {
+        Reader r(bytes.substr(headerSize));
+        uint64_t names = r.value<uint64_t>();
+        entry.names.clear();
+        for (uint64_t i = 0; r.ok && i < names; ++i) entry.names.push_back(r.text());
+        r.array(entry.ast.kind);
+        r.array(entry.ast.lhs);
+        r.array(entry.ast.rhs);
+        r.array(entry.ast.payload);
+        r.array(entry.ast.line);
+        r.array(entry.ast.statements);
+        readProgram(r, entry.ir);
+        readProgram(r, entry.optimizedIR);
+        uint64_t lines = r.value<uint64_t>();
+        entry.assembly.clear();
+        for (uint64_t i = 0; r.ok && i < lines; ++i) entry.assembly.push_back(r.text());
+        entry.diagnostics = r.text();
+        ok = r.ok && r.atEnd();
+    }
+
+    if (!ok) {
+        count(&Stats::misses);
+        fs::remove(path, ec); // corrupt or from a colliding key; recompile and replace it
+        return false;
+    }
+
+    // least recently used = oldest modification time
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    count(&Stats::hits);
+    return true;
+}
+
+bool CompileCache::store(const Key& key, const CacheEntry& entry) {
+    Writer w;
+    w.value<uint64_t>(entry.names.size());
+    for (const auto& name : entry.names) w.text(name);
+    w.array(entry.ast.kind);
+    w.array(entry.ast.lhs);
+    w.array(entry.ast.rhs);
+    w.array(entry.ast.payload);
+    w.array(entry.ast.line);
+    w.array(entry.ast.statements);
+    writeProgram(w, entry.ir);
+    writeProgram(w, entry.optimizedIR);
+    w.value<uint64_t>(entry.assembly.size());
+    for (const auto& line : entry.assembly) w.text(line);
+    w.text(entry.diagnostics);
+
+    Writer header;
+    for (char c : MAGIC) header.value(c);
+    header.value(key.hi);
+    header.value(key.lo);
+    header.value(key.sourceSize);
+    header.value(hashBytes(w.bytes));
+    if (header.bytes.size() + w.bytes.size() > maxBytes) return false;
+
+    // write a private temporary file, then rename it over the final name:
+    // readers see either no entry or a complete one
+    std::string path = pathFor(key);
+    std::string tmp = path + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(header.bytes.data(), static_cast<std::streamsize>(header.bytes.size()));
+        out.write(w.bytes.data(), static_cast<std::streamsize>(w.bytes.size()));
+        if (!out) {
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    count(&Stats::stores);
+    evict();
+    return true;
+}
+
+void CompileCache::count(size_t Stats::*counter) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++(counters.*counter);
+}
+
+// Drop the least recently used entries until the directory fits in
+// maxBytes. Another process may be evicting at the same time; files that
+// are already gone are simply skipped.
+void CompileCache::evict() {
+    // one thread at a time within this process
+    std::lock_guard<std::mutex> lock(evicting);
+    struct File {
+        fs::path path;
+        fs::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<File> files;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != EXTENSION) continue;
+        std::error_code fileEc;
+        uintmax_t size = it->file_size(fileEc);
+        fs::file_time_type time = it->last_write_time(fileEc);
+        if (fileEc) continue;
+        files.push_back({it->path(), time, size});
+        total += size;
+    }
+    if (total <= maxBytes) return;
+
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.time < b.time; });
+    for (const File& f : files) {
+        if (total <= maxBytes) break;
+        if (fs::remove(f.path, ec)) count(&Stats::evictions);
+        total -= f.size;
+    }
+}
@@ -1,122 +1,126 @@
 #include "codegen.h"
 #include "ir.h"
+#include "regalloc.h"
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <cctype>
+#include <cstdint>
 
-static bool isNumber(const std::string& s) {
-    if (s.empty()) return false;
-    size_t i = 0;
-    if (s[0] == '+' || s[0] == '-') i = 1;
-    for (; i < s.size(); ++i) if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
-    return true;
-}
-// Check if a string is a quoted string (i.e., a string literal)
-static bool isQuotedString(const std::string& s) {
-    return s.size() >= 2 && s.front() == '"' && s.back() == '"';
+// Check if an operand is a literal (an integer or a quoted string)
+static bool isLiteral(Operand o) {
+    return o.kind == OperandKind::Int || o.kind == OperandKind::Str;
 }
 
-std::vector<std::string> CodeGenerator::generateAssembly(const std::vector<IRInstruction>& ir) {
-    std::vector<std::string> out;
-    std::unordered_map<std::string,std::string> reg;
-    int rc = 1;
+CodeGenerator::CodeGenerator(int registers) : registers(registers) {}
 
-    auto alloc = [&](const std::string& name) {
-        auto it = reg.find(name);
-        if (it != reg.end()) return it->second;
-        std::string r = "R" + std::to_string(rc++);
-        reg[name] = r;
+std::vector<std::string> CodeGenerator::generateAssembly(const IRProgram& ir, const SymbolTable& symbols) {
+    std::vector<std::string> out;
+    RegisterAllocation ra = RegisterAllocation::build(ir, registers);
+    lastStats = ra.stats;
+
+    auto text = [&](Operand o) { return operandText(ir, o, symbols); };
+    auto name = [](int reg) { return "R" + std::to_string(reg); };
+    auto slotName = [](int slot) { return "[S" + std::to_string(slot) + "]"; };
+    // spill code goes through the registers held back at the top
+    auto scratch = [&](int k) { return name(registers - ra.stats.scratch + k); };
+
+    // register holding argument k of instruction idx, loading it first if
+    // it is a literal, a variable or a spilled value
+    auto use = [&](size_t idx, int k) {
+        Operand o = k == 0 ? ir.code[idx].arg1() : ir.code[idx].arg2();
+        const LiveInterval& iv = ra.intervals[ra.operand[idx * 2 + k]];
+        std::string r = iv.reg >= 0 ? name(iv.reg) : scratch(k);
+        if (iv.literal) {
+            out.push_back("LOAD " + text(o) + ", " + r);
+            if (iv.reg < 0 && isLiteral(o)) ++lastStats.rematerialized;
+        } else if (iv.reg < 0) {
+            out.push_back("RELOAD " + slotName(iv.slot) + ", " + r);
+            ++lastStats.reloads;
+        }
         return r;
     };
+    // register for the result of instruction idx; a spilled result is
+    // stored by spill() after the instruction
+    auto def = [&](size_t idx) {
+        const LiveInterval& iv = ra.intervals[ra.result[idx]];
+        return iv.reg >= 0 ? name(iv.reg) : scratch(0);
+    };
+    auto spill = [&](size_t idx) {
+        const LiveInterval& iv = ra.intervals[ra.result[idx]];
+        if (iv.slot < 0) return;
+        out.push_back("SPILL " + scratch(0) + ", " + slotName(iv.slot));
+        ++lastStats.spillStores;
+    };
 
-    for (const auto &ins : ir) {
-        if (!ins.op.empty() && ins.op[0] == ';') {
-            out.push_back(ins.op);
-            continue;
-        }
-
-        std::string op = ins.op;
-
-        if (op == "MOV") {
-            if (isNumber(ins.arg1) || isQuotedString(ins.arg1)) {
-                std::string dest = alloc(ins.result);
-                out.push_back(std::string("LOAD ") + ins.arg1 + ", " + dest);
-            } else {
-                std::string src = alloc(ins.arg1);
-                std::string dest = alloc(ins.result);
-                out.push_back(std::string("MOV ") + src + ", " + dest);
-            }
-            continue;
-        }
-
-        if (op == "LOAD") {
-            std::string dst = alloc(ins.result);
-            out.push_back(std::string("LOAD ") + ins.arg1 + ", " + dst);
-            continue;
-        }
-
-        if (op == "STORE") {
-            std::string src = alloc(ins.arg1);
-            out.push_back(std::string("STORE ") + src + ", " + ins.result);
-            continue;
-        }
-
-        if (op == "PRINT") {
-            if (isNumber(ins.arg1) || isQuotedString(ins.arg1)) {
-                out.push_back(std::string("PRINT ") + ins.arg1);
-            } else {
-                std::string r = alloc(ins.arg1);
-                out.push_back(std::string("PRINT ") + r);
+    size_t note = 0;
+    for (size_t idx = 0; idx < ir.code.size(); ++idx) {
+        // comments and errors are copied through so they stay visible
+        for (; note < ir.notes.size() && ir.notes[note].before == idx; ++note) out.push_back(ir.notes[note].text);
+
+        const IRInstruction& ins = ir.code[idx];
+        Operand a = ins.arg1();
+
+        switch (ins.op) {
+            case IROp::Mov:
+                if (isLiteral(a)) {
+                    out.push_back("LOAD " + text(a) + ", " + def(idx));
+                } else {
+                    std::string src = use(idx, 0);
+                    std::string dest = def(idx);
+                    // the allocator prefers the source's register
+                    if (src != dest) out.push_back("MOV " + src + ", " + dest);
+                }
+                spill(idx);
+                break;
+
+            case IROp::Load:
+                out.push_back("LOAD " + text(a) + ", " + def(idx));
+                spill(idx);
+                break;
+
+            case IROp::Store: {
+                std::string src = use(idx, 0);
+                out.push_back("STORE " + src + ", " + text(ins.result()));
+                break;
             }
-            continue;
-        }
-
-        if (op == "READ") {
-            // READ -> var (represent as reading into register then storing)
-            std::string dst = alloc(ins.result);
-            out.push_back(std::string("READ -> ") + dst);
-            out.push_back(std::string("STORE ") + dst + ", " + ins.result);
-            continue;
-        }
-
-        // arithmetic ops
-        if (op == "ADD" || op == "SUB" || op == "MUL" || op == "DIV") {
-            std::string a = ins.arg1;
-            std::string b = ins.arg2;
-            std::string ra, rb;
 
-            // ensure left operand in register
-            if (isNumber(a) || isQuotedString(a)) {
-                ra = alloc("<const#" + a + ">");
-                out.push_back(std::string("LOAD ") + a + ", " + ra);
-            } else {
-                ra = alloc(a);
+            case IROp::Print:
+                if (isLiteral(a)) {
+                    out.push_back("PRINT " + text(a));
+                } else {
+                    out.push_back("PRINT " + use(idx, 0));
+                }
+                break;
+
+            case IROp::Read: {
+                // READ -> var (represent as reading into register then storing)
+                std::string dst = def(idx);
+                out.push_back("READ -> " + dst);
+                out.push_back("STORE " + dst + ", " + text(ins.result()));
+                break;
             }
 
-            // ensure right operand in register
-            if (isNumber(b) || isQuotedString(b)) {
-                rb = alloc("<const#" + b + ">");
-                out.push_back(std::string("LOAD ") + b + ", " + rb);
-            } else {
-                rb = alloc(b);
+            case IROp::Nop:
+                break;
+
+            case IROp::Add:
+            case IROp::Sub:
+            case IROp::Mul:
+            case IROp::Div:
+            case IROp::IAdd:
+            case IROp::ISub:
+            case IROp::IMul:
+            case IROp::IDiv:
+            case IROp::Concat: {
+                std::string ra = use(idx, 0);
+                std::string rb = use(idx, 1);
+                std::string rd = def(idx);
+                out.push_back(std::string(irOpName(ins.op)) + " " + ra + ", " + rb + ", " + rd);
+                spill(idx);
+                break;
             }
-
-            std::string rd = alloc(ins.result);
-            std::string opcode = (op == "ADD") ? "ADD" : (op == "SUB") ? "SUB" : (op == "MUL") ? "MUL" : "DIV";
-            out.push_back(opcode + " " + ra + ", " + rb + ", " + rd);
-            continue;
         }
-
-        // If it's a comment-like ERROR entry, propagate as PRINT-able text
-        if (!op.empty() && op.rfind("; ERROR", 0) == 0) {
-            out.push_back(op);
-            continue;
-        }
-
-        // Unhandled IR: emit as comment so it's visible
-        out.push_back(std::string("; UNHANDLED IR: ") + op + " " + ins.arg1 + " " + ins.arg2 + " -> " + ins.result);
     }
+    for (; note < ir.notes.size(); ++note) out.push_back(ir.notes[note].text);
 
     if (out.empty()) out.push_back("; <no assembly generated>");
     return out;
@@ -0,0 +1,58 @@
+#include "flatast.h"
+#include <utility>
+
+NodeIndex FlatAST::add(NodeKind k, int64_t value, int32_t ln, NodeIndex l, NodeIndex r) {
+    NodeIndex id = static_cast<NodeIndex>(kind.size());
+    kind.push_back(k);
+    lhs.push_back(l);
+    rhs.push_back(r);
+    payload.push_back(value);
+    line.push_back(ln);
+    return id;
+}
+
+void FlatAST::truncate(size_t size) {
+    kind.resize(size);
+    lhs.resize(size);
+    rhs.resize(size);
+    payload.resize(size);
+    line.resize(size);
+}
+
+static int64_t payloadOf(const ASTNode* node) {
+    switch (node->kind) {
+        case NodeKind::Number: return node->number;
+        case NodeKind::BinOp: return node->op;
+        case NodeKind::Cout: return 0;
+        default: return node->symbol;
+    }
+}
+
+FlatAST FlatAST::fromTree(const std::vector<ASTNode*>& nodes) {
+    FlatAST flat;
+    // (node, children done) work stack and the indices of finished children
+    std::vector<std::pair<const ASTNode*, bool>> work;
+    std::vector<NodeIndex> done;
+
+    for (const ASTNode* root : nodes) {
+        if (!root) continue;
+        work.push_back({root, false});
+        while (!work.empty()) {
+            auto [node, expanded] = work.back();
+            work.pop_back();
+            if (!expanded) {
+                work.push_back({node, true});
+                if (node->right) work.push_back({node->right, false});
+                if (node->left) work.push_back({node->left, false});
+                continue;
+            }
+            NodeIndex r = NO_NODE, l = NO_NODE;
+            if (node->right) { r = done.back(); done.pop_back(); }
+            if (node->left) { l = done.back(); done.pop_back(); }
+            done.push_back(flat.add(node->kind, payloadOf(node), node->line, l, r));
+        }
+        flat.statements.push_back(done.back());
+        done.pop_back();
+    }
+    return flat;
+}
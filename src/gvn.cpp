@@ -0,0 +1,317 @@
+#include "gvn.h"
+#include "hash.h"
+#include "ssa.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t NO_VALUE = UINT32_MAX;
+
+// Hash table key of a value: an opcode (or one of the tags below) and up
+// to two operands - value numbers, a constant or a variable version.
+enum KeyTag : uint8_t {
+    IntConst = 64, // a: the constant
+    StrConst,      // a: the literal's Symbol
+    AddChain,      // a: base value, b: int offset
+    MulChain       // a: base value, b: int factor
+};
+
+struct Key {
+    uint64_t a = 0, b = 0;
+    uint8_t tag = 0;
+};
+
+// Open-addressing map from Key to value number. One lookup per
+// instruction dominates the pass, so it probes a flat array instead of
+// chasing unordered_map nodes.
+class ValueTable {
+private:
+    struct Slot {
+        uint64_t a, b;
+        uint32_t value = NO_VALUE; // NO_VALUE = empty
+        uint8_t tag;
+    };
+    std::vector<Slot> slots;
+    size_t used = 0;
+
+    size_t home(uint64_t a, uint64_t b, uint8_t tag) const {
+        return mix64(a ^ mix64(b ^ (static_cast<uint64_t>(tag) << 56))) & (slots.size() - 1);
+    }
+    size_t probe(const Key& k) const {
+        size_t i = home(k.a, k.b, k.tag);
+        while (slots[i].value != NO_VALUE && !(slots[i].a == k.a && slots[i].b == k.b && slots[i].tag == k.tag))
+            i = (i + 1) & (slots.size() - 1);
+        return i;
+    }
+
+public:
+    explicit ValueTable(size_t expected) {
+        size_t n = 64;
+        while (n < expected * 2) n *= 2;
+        slots.resize(n);
+    }
+
+    // The value number for `k`, or NO_VALUE.
+    uint32_t find(const Key& k) const { return slots[probe(k)].value; }
+
+    void set(const Key& k, uint32_t value) {
+        if ((used + 1) * 2 > slots.size()) {
+            std::vector<Slot> old(slots.size() * 2);
+            old.swap(slots);
+            for (const Slot& s : old) {
+                if (s.value != NO_VALUE) slots[probe({s.a, s.b, s.tag})] = s;
+            }
+        }
+        Slot& s = slots[probe(k)];
+        if (s.value == NO_VALUE) ++used;
+        s = {k.a, k.b, value, k.tag};
+    }
+};
+
+struct Value {
+    ValueFacts facts;
+    Operand rep;      // temp or immediate holding the value
+    uint32_t stmt;    // statement that computes rep
+    bool global;      // rep is computed whenever its statement runs
+    uint32_t base = NO_VALUE; // value is base + offset or base * offset
+    IROp chain = IROp::Add;
+    int64_t offset = 0;
+};
+
+const char* opSymbol(IROp op) {
+    switch (op) {
+        case IROp::Add: return "+";
+        case IROp::Sub: return "-";
+        case IROp::Mul: return "*";
+        default: return "/";
+    }
+}
+
+}
+
+bool ValueNumbering::run(DefUse& du, OptimizationReport& report) {
+    IRProgram& ir = du.program();
+    SSAInfo ssa = SSAInfo::build(ir);
+
+    std::vector<Value> values;
+    ValueTable table(ir.code.size() / 4);
+    values.reserve(ir.code.size() / 2);
+    std::vector<uint32_t> tempValue(ir.temps + 1, NO_VALUE);
+    std::vector<uint32_t> versionValue(ssa.versionVar.size(), NO_VALUE);
+    std::vector<bool> defined; // per variable, as in SSAInfo
+
+    uint32_t stmt = 0;
+    bool prefixSafe = true;
+    bool changed = false;
+
+    auto isDefined = [&](Symbol var) { return var < defined.size() && defined[var]; };
+    auto define = [&](Symbol var) {
+        if (var >= defined.size()) defined.resize(var + 1, false);
+        defined[var] = true;
+    };
+    auto available = [&](uint32_t v) { return values[v].stmt == stmt || (global && values[v].global); };
+    auto addValue = [&](const Key& key, Value v) {
+        values.push_back(v);
+        table.set(key, static_cast<uint32_t>(values.size() - 1));
+        return static_cast<uint32_t>(values.size() - 1);
+    };
+    auto intValue = [&](int64_t c, Operand existing) {
+        Key key{static_cast<uint64_t>(c), 0, IntConst};
+        uint32_t found = table.find(key);
+        if (found != NO_VALUE) return found;
+        if (existing.kind == OperandKind::None) existing = ir.imm(c);
+        return addValue(key, {intConstant(c), existing, 0, true});
+    };
+    // whether value `v` is just what a LOAD read (not a known value)
+    auto loadedOnly = [&](uint32_t v) {
+        Operand rep = values[v].rep;
+        return rep.kind == OperandKind::Temp && ir.code[du.definition(rep.id)].op == IROp::Load;
+    };
+    auto operandValue = [&](Operand o) {
+        switch (o.kind) {
+            case OperandKind::Temp: return tempValue[o.id];
+            case OperandKind::Int: return intValue(ir.intValue(o), o);
+            case OperandKind::Str: {
+                Key key{o.id, 0, StrConst};
+                uint32_t found = table.find(key);
+                if (found != NO_VALUE) return found;
+                return addValue(key, {ValueFacts(), o, 0, true});
+            }
+            default: return NO_VALUE;
+        }
+    };
+
+    for (uint32_t idx = 0; idx < ir.code.size(); ++idx) {
+        // the instruction is dropped; its readers read value `v` instead
+        auto forward = [&](uint32_t v) {
+            du.replaceUses(ir.code[idx].ids[2], values[v].rep);
+            du.remove(idx);
+            changed = true;
+        };
+
+        IRInstruction ins = ir.code[idx];
+        if (ins.op == IROp::Nop) continue;
+        Operand a = ins.arg1(), b = ins.arg2(), res = ins.result();
+
+        bool fault = false;
+        Key key;
+        Value made{ValueFacts(), res, stmt, false};
+        switch (ins.op) {
+            case IROp::Mov:
+                // literals and copies are forwarded into their uses
+                report.copies = true;
+                forward(operandValue(a));
+                continue;
+
+            case IROp::Load: {
+                // versions are dense, so loads need no hashing
+                uint32_t& loaded = versionValue[ssa.version[idx]];
+                if (loaded != NO_VALUE && available(loaded)) {
+                    // an earlier load of the same version, or the stored value
+                    ++(loadedOnly(loaded) ? report.redundant : report.forwarded);
+                    forward(loaded);
+                    continue;
+                }
+                fault = !isDefined(a.id);
+                prefixSafe = prefixSafe && !fault;
+                values.push_back({ValueFacts(), res, stmt, prefixSafe});
+                loaded = tempValue[res.id] = static_cast<uint32_t>(values.size() - 1);
+                continue;
+            }
+
+            case IROp::Store:
+                // a store that certainly happens gives its version the
+                // stored value: later loads are forwarded from it. READ
+                // leaves the version unknown, so loads after it stay.
+                if (prefixSafe) {
+                    define(res.id);
+                    versionValue[ssa.version[idx]] = operandValue(a);
+                }
+                break;
+            case IROp::Read:
+                define(res.id);
+                break;
+            case IROp::Print:
+                if (a.kind == OperandKind::Var) {
+                    uint32_t stored = versionValue[ssa.version[idx]];
+                    if (stored != NO_VALUE && available(stored) && !loadedOnly(stored)) {
+                        du.setArgument(idx, 0, values[stored].rep);
+                        ++report.forwarded;
+                        changed = true;
+                    } else {
+                        fault = !isDefined(a.id);
+                    }
+                }
+                break;
+
+            default: {
+                // typed ops simplify as their untyped op does, on operands
+                // the semantic analyzer proved to be ints
+                IROp typed = ins.op, op = untypedOp(typed);
+                uint32_t va = operandValue(a), vb = operandValue(b);
+                ValueFacts fa = values[va].facts, fb = values[vb].facts;
+                if (typed != op && typed != IROp::Concat) fa.isInt = fb.isInt = true;
+
+                int64_t folded;
+                if (fa.isConst && fb.isConst && foldArithmetic(op, fa.constant, fb.constant, folded)) {
+                    forward(intValue(folded, Operand()));
+                    if (report.foldedExamples.size() < OptimizationReport::EXAMPLES) {
+                        report.foldedExamples.push_back("(" + std::to_string(fa.constant) + " " + opSymbol(op) + " " +
+                                                       std::to_string(fb.constant) + ") -> " + std::to_string(folded));
+                    }
+                    continue;
+                }
+                if (op == IROp::Div && fb.isConst && fb.constant == 0) report.divByZero = true;
+
+                // identities, for operands known to be integers
+                auto is = [](const ValueFacts& f, int64_t c) { return f.isConst && f.constant == c; };
+                uint32_t same = NO_VALUE;
+                if ((op == IROp::Add || op == IROp::Sub) && is(fb, 0) && fa.isInt) same = va;
+                else if (op == IROp::Add && is(fa, 0) && fb.isInt) same = vb;
+                else if ((op == IROp::Mul || op == IROp::Div) && is(fb, 1) && fa.isInt) same = va;
+                else if (op == IROp::Mul && is(fa, 1) && fb.isInt) same = vb;
+                else if (op == IROp::Mul && ((is(fa, 0) && fb.numeric()) || (is(fb, 0) && fa.numeric())))
+                    same = intValue(0, Operand());
+                if (same != NO_VALUE) {
+                    forward(same);
+                    continue;
+                }
+
+                // integer value op constant, as base + offset or base * factor
+                uint32_t base = NO_VALUE;
+                int64_t c = 0;
+                IROp chain = op == IROp::Mul ? IROp::Mul : IROp::Add;
+                if (op == IROp::Add || op == IROp::Mul) {
+                    if (fb.isConst && fa.isInt) base = va, c = fb.constant;
+                    else if (fa.isConst && fb.isInt) base = vb, c = fa.constant;
+                } else if (op == IROp::Sub && fb.isConst && fa.isInt) {
+                    base = va;
+                    c = static_cast<int64_t>(0 - static_cast<uint64_t>(fb.constant));
+                }
+                if (base != NO_VALUE) {
+                    const Value& inner = values[base];
+                    if (inner.base != NO_VALUE && inner.chain == chain && available(inner.base)) {
+                        // (x + 1) + 2 -> x + 3, (x * 2) * 3 -> x * 6
+                        uint64_t x = static_cast<uint64_t>(inner.offset), y = static_cast<uint64_t>(c);
+                        base = inner.base;
+                        c = static_cast<int64_t>(chain == IROp::Add ? x + y : x * y);
+                        ++report.reassociated;
+                        if (c == (chain == IROp::Add ? 0 : 1)) {
+                            forward(base);
+                            continue;
+                        }
+                        if (chain == IROp::Mul && c == 0) {
+                            forward(intValue(0, Operand()));
+                            continue;
+                        }
+                        // an int and a constant: the result is typed
+                        bool negative = chain == IROp::Add && c < 0 && c != INT64_MIN;
+                        typed = chain == IROp::Mul ? IROp::IMul : negative ? IROp::ISub : IROp::IAdd;
+                        op = untypedOp(typed);
+                        a = values[base].rep;
+                        b = ir.imm(negative ? -c : c);
+                        ins = IRInstruction(typed, res, a, b);
+                        du.rewrite(idx, ins);
+                        changed = true;
+                        va = base;
+                        vb = operandValue(b);
+                        fa = values[va].facts;
+                        fb = values[vb].facts;
+                    }
+                    key = {base, static_cast<uint64_t>(c), chain == IROp::Add ? AddChain : MulChain};
+                    made.base = base;
+                    made.chain = chain;
+                    made.offset = c;
+                } else {
+                    // "*" always commutes, "+" only when it adds
+                    bool commutes = op == IROp::Mul || (op == IROp::Add && fa.isInt && fb.isInt);
+                    if (commutes && vb < va) std::swap(va, vb);
+                    key = {va, vb, static_cast<uint8_t>(op)};
+                }
+
+                uint32_t found = table.find(key);
+                if (found != NO_VALUE && available(found)) {
+                    forward(found);
+                    ++report.redundant;
+                    continue;
+                }
+                fault = arithmeticCanFault(typed, fa, fb);
+                made.facts = arithmeticResult(typed, fa, fb);
+                break;
+            }
+        }
+
+        prefixSafe = prefixSafe && !fault;
+        if (key.tag != 0) {
+            made.global = prefixSafe;
+            tempValue[res.id] = addValue(key, made);
+        }
+        if (endsStatement(ins.op)) {
+            ++stmt;
+            prefixSafe = true;
+        }
+    }
+    return changed;
+}
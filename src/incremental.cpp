@@ -0,0 +1,238 @@
+#include "incremental.h"
+#include "codegen.h"
+#include "flatast.h"
+#include "hash.h"
+#include "optimizer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <unordered_map>
+
+IncrementalCompiler::IncrementalCompiler(int optLevel, int registers)
+    : ctx(std::make_unique<CompileContext>()), optLevel(optLevel), registers(registers) {}
+
+// Replace `count` elements of `v` at `pos` with `items`.
+template <typename T>
+static void splice(std::vector<T>& v, size_t pos, size_t count, std::vector<T>& items) {
+    v.erase(v.begin() + pos, v.begin() + pos + count);
+    v.insert(v.begin() + pos, std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+}
+
+// Parse `text` (statement `index`, starting at `firstLine`) and run it
+// through IR generation, the optimizer and codegen.
+void IncrementalCompiler::build(size_t index, std::string_view text, int firstLine) {
+    StatementUnit& unit = *units[index];
+    liveArenaBytes -= unit.arenaBytes;
+    unit = StatementUnit();
+    unit.builtLine = firstLine;
+    lines[index] = firstLine;
+
+    size_t before = ctx->arena.bytesUsed();
+    std::ostringstream diag;
+    try {
+        Lexer lexer(text, ctx->symbols, firstLine);
+        Parser parser(lexer, ctx->arena, diag);
+        unit.nodes = parser.parse();
+    } catch (const std::exception& e) {
+        // a lexer error ends the whole parse in batch mode; here it only
+        // costs this statement
+        diag << "Error: " << e.what() << "\n";
+    }
+    unit.arenaBytes = ctx->arena.bytesUsed() - before;
+    liveArenaBytes += unit.arenaBytes;
+    unit.diagnostics = diag.str();
+
+    // reads and writes, resolved within the range the way
+    // SemanticAnalyzer::analyze(FlatAST) does it
+    uint64_t mask = 0;
+    FlatAST flat = FlatAST::fromTree(unit.nodes);
+    for (size_t s = 0; s < flat.statements.size(); ++s) {
+        NodeIndex root = flat.statements[s];
+        if (flat.kind[root] == NodeKind::Assign || flat.kind[root] == NodeKind::Cin)
+            unit.writes.push_back(static_cast<Symbol>(flat.payload[root]));
+
+        for (NodeIndex i = flat.begin(s); i < root; ++i) {
+            if (flat.kind[i] != NodeKind::Variable) continue;
+            Symbol name = static_cast<Symbol>(flat.payload[i]);
+            if (std::find(unit.writes.begin(), unit.writes.end(), name) != unit.writes.end()) continue;
+            unit.reads.push_back({name, flat.line[i] - firstLine});
+            mask |= uint64_t(1) << (name % 64);
+        }
+    }
+    readMasks[index] = mask;
+    soleWrite[index] = unit.writes.empty() ? NO_SYMBOL : unit.writes.size() == 1 ? unit.writes[0] : MANY_WRITES;
+
+    IRGenerator irgen(ctx->symbols);
+    unit.ir = irgen.generate(unit.nodes);
+
+    // drop the optimizer's summary notes in front of the code; a
+    // statement's own notes always follow the instruction they describe
+    // whole-program passes (-O2) would treat the statement as the program
+    Optimizer opt(std::min(optLevel, 1));
+    unit.optimizedIR = opt.optimize(unit.ir);
+    auto& notes = unit.optimizedIR.notes;
+    notes.erase(notes.begin(), std::find_if(notes.begin(), notes.end(), [](const IRNote& n) { return n.before != 0; }));
+
+    CodeGenerator codegen(registers);
+    unit.assembly = codegen.generateAssembly(unit.optimizedIR, ctx->symbols);
+
+    lineSensitive[index] = !unit.diagnostics.empty() || !unit.ir.notes.empty();
+}
+
+// A read is fine if some statement before `position` assigns the variable;
+// reads satisfied inside the statement itself were dropped by build().
+void IncrementalCompiler::check(StatementUnit& unit, uint32_t position, const std::vector<uint32_t>& firstWrite) {
+    unit.undeclaredRead = -1;
+    for (size_t r = 0; r < unit.reads.size(); ++r) {
+        Symbol name = unit.reads[r].first;
+        if (name >= firstWrite.size() || firstWrite[name] >= position) {
+            unit.undeclaredRead = static_cast<int>(r);
+            return;
+        }
+    }
+}
+
+UpdateStats IncrementalCompiler::update(std::string_view text) {
+    auto start = std::chrono::steady_clock::now();
+    UpdateStats stats;
+
+    // Replaced statements leave their nodes behind in the arena; once they
+    // outweigh the live ones, start over from a fresh context.
+    if (ctx->arena.bytesUsed() > 2 * liveArenaBytes + (1u << 20)) {
+        *this = IncrementalCompiler(optLevel, registers);
+        stats.compacted = true;
+    }
+
+    std::vector<SourceChunk> ranges = statementRanges(text);
+    std::vector<uint64_t> newHashes(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+        newHashes[i] = hashBytes(text.substr(ranges[i].begin, ranges[i].end - ranges[i].begin));
+
+    // the edited region: everything between the common prefix and suffix
+    size_t oldCount = units.size(), newCount = ranges.size();
+    size_t prefix = 0, suffix = 0;
+    while (prefix < oldCount && prefix < newCount && hashes[prefix] == newHashes[prefix]) ++prefix;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix &&
+           hashes[oldCount - 1 - suffix] == newHashes[newCount - 1 - suffix]) ++suffix;
+    size_t oldEnd = oldCount - suffix, newEnd = newCount - suffix;
+
+    // Inside it, old statements are matched by hash, greedily and in order:
+    // each new range takes the first unused old statement with its hash
+    // after the previous match, so reused statements keep their order.
+    std::unordered_map<uint64_t, std::pair<std::vector<size_t>, size_t>> byHash;
+    for (size_t i = prefix; i < oldEnd; ++i) byHash[hashes[i]].first.push_back(i);
+
+    size_t middle = newEnd - prefix;
+    std::vector<std::unique_ptr<StatementUnit>> midUnits(middle);
+    std::vector<uint64_t> midHashes(newHashes.begin() + prefix, newHashes.begin() + newEnd);
+    std::vector<int> midLines(middle, 0);
+    std::vector<Symbol> midWrites(middle, NO_SYMBOL);
+    std::vector<uint64_t> midMasks(middle, 0);
+    std::vector<bool> midSensitive(middle, false);
+    std::vector<bool> midFailing(middle, false);
+    std::vector<bool> fresh(middle, true);
+    size_t nextOld = prefix;
+
+    for (size_t k = 0; k < middle; ++k) {
+        auto it = byHash.find(midHashes[k]);
+        if (it == byHash.end()) continue;
+        auto& [candidates, head] = it->second;
+        while (head < candidates.size() && candidates[head] < nextOld) ++head;
+        if (head == candidates.size()) continue;
+
+        size_t old = candidates[head++];
+        nextOld = old + 1;
+        midUnits[k] = std::move(units[old]);
+        midLines[k] = lines[old];
+        midWrites[k] = soleWrite[old];
+        midMasks[k] = readMasks[old];
+        midSensitive[k] = lineSensitive[old];
+        midFailing[k] = failing[old];
+        fresh[k] = false;
+    }
+
+    uint64_t dirtyMask = 0; // variables that gained or lost a writer
+    for (size_t i = prefix; i < oldEnd; ++i) {
+        if (!units[i]) continue; // reused
+        for (Symbol w : units[i]->writes) dirtyMask |= uint64_t(1) << (w % 64);
+        liveArenaBytes -= units[i]->arenaBytes;
+    }
+    for (auto& unit : midUnits) {
+        if (!unit) unit = std::make_unique<StatementUnit>();
+    }
+
+    splice(units, prefix, oldEnd - prefix, midUnits);
+    splice(hashes, prefix, oldEnd - prefix, midHashes);
+    splice(lines, prefix, oldEnd - prefix, midLines);
+    splice(soleWrite, prefix, oldEnd - prefix, midWrites);
+    splice(readMasks, prefix, oldEnd - prefix, midMasks);
+    splice(lineSensitive, prefix, oldEnd - prefix, midSensitive);
+    splice(failing, prefix, oldEnd - prefix, midFailing);
+
+    // Build the new statements. Reused ones after the edit may have moved:
+    // those whose output quotes line numbers are rebuilt, the rest only get
+    // their new line.
+    for (size_t i = prefix; i < newCount; ++i) {
+        const SourceChunk& range = ranges[i];
+        bool isNew = i < newEnd && fresh[i - prefix];
+        if (!isNew) {
+            if (lines[i] == range.firstLine) continue;
+            lines[i] = range.firstLine;
+            if (!lineSensitive[i]) continue;
+        }
+        build(i, text.substr(range.begin, range.end - range.begin), range.firstLine);
+        if (isNew) {
+            for (Symbol w : units[i]->writes) dirtyMask |= uint64_t(1) << (w % 64);
+        }
+        stats.changed.push_back(i);
+    }
+
+    // first writer of every variable, from the dense write array
+    std::vector<uint32_t> firstWrite(ctx->symbols.size(), UINT32_MAX);
+    for (uint32_t p = 0; p < newCount; ++p) {
+        Symbol w = soleWrite[p];
+        if (w == NO_SYMBOL) continue;
+        if (w != MANY_WRITES) {
+            if (firstWrite[w] == UINT32_MAX) firstWrite[w] = p;
+            continue;
+        }
+        for (Symbol each : units[p]->writes) {
+            if (firstWrite[each] == UINT32_MAX) firstWrite[each] = p;
+        }
+    }
+
+    size_t nextChanged = 0;
+    for (uint32_t p = 0; p < newCount; ++p) {
+        if (nextChanged < stats.changed.size() && stats.changed[nextChanged] == p) {
+            ++nextChanged;
+        } else if (readMasks[p] & dirtyMask) {
+            ++stats.rechecked;
+        } else {
+            ++stats.reused;
+            continue;
+        }
+        check(*units[p], p, firstWrite);
+        failing[p] = units[p]->undeclaredRead >= 0;
+    }
+
+    stats.statements = newCount;
+    stats.rebuilt = stats.changed.size();
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+std::string IncrementalCompiler::semanticError(size_t index) const {
+    const StatementUnit& unit = *units[index];
+    if (unit.undeclaredRead < 0) return "";
+    const auto& [name, offset] = unit.reads[unit.undeclaredRead];
+    return "Use of undeclared variable: " + ctx->symbols.name(name) + " at line " + std::to_string(lines[index] + offset);
+}
+
+std::string IncrementalCompiler::firstSemanticError() const {
+    for (size_t i = 0; i < failing.size(); ++i) {
+        if (failing[i]) return semanticError(i);
+    }
+    return "";
+}
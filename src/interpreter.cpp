@@ -1,110 +1,282 @@
 #include "interpreter.h"
-#include <iostream>
-#include <stdexcept>
+#include "runtime.h"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
 #include <cstdlib>
-#include <cctype>
 #include <string>
 
-bool Interpreter::tryParseInt(const std::string& s, int& out) {
-    try {
-        size_t idx = 0;
-        long v = std::stol(s, &idx, 10);
-        if (idx != s.size()) return false;
-        out = static_cast<int>(v);
-        return true;
-    } catch (...) {
+// GCC and Clang jump straight from one instruction's handler to the next
+// through a table of label addresses; elsewhere the loop is a switch.
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+Interpreter::Interpreter(const SymbolTable& symbols) : symbols(symbols) {}
+
+namespace {
+
+// Int arithmetic wraps. Only a zero divisor fails; INT64_MIN / -1 wraps too.
+template <char OP>
+inline bool apply(int64_t x, int64_t y, int64_t& out) {
+    uint64_t ux = static_cast<uint64_t>(x), uy = static_cast<uint64_t>(y);
+    switch (OP) {
+        case '+': out = static_cast<int64_t>(ux + uy); return true;
+        case '-': out = static_cast<int64_t>(ux - uy); return true;
+        case '*': out = static_cast<int64_t>(ux * uy); return true;
+        default:
+            if (y == 0) return false;
+            out = y == -1 ? static_cast<int64_t>(0 - ux) : x / y;
+            return true;
+    }
+}
+
+}
+
+void Interpreter::undefined(uint32_t reg, int line) {
+    error = "Runtime error: Undefined variable '" + symbols.name(program->variables[reg]) + "' at line " +
+            std::to_string(line);
+}
+
+bool Interpreter::arith(char op, const Value& left, const Value& right, uint32_t b, uint32_t c, int line,
+                        Value& out) {
+    if (left.kind == Value::Kind::None) return undefined(b, line), false;
+    if (right.kind == Value::Kind::None) return undefined(c, line), false;
+
+    int64_t x, y, v;
+    bool numbers = left.numeric(x) && right.numeric(y);
+    const char* verb = nullptr;
+    switch (op) {
+        case '+':
+            if (!numbers) {
+                // not both numeric: concatenate the texts
+                Value joined = Value::concat(left, right);
+                out = std::move(joined);
+                return true;
+            }
+            apply<'+'>(x, y, v);
+            break;
+        case '-':
+            if (!numbers) verb = "subtract";
+            else apply<'-'>(x, y, v);
+            break;
+        case '*':
+            if (!numbers) verb = "multiply";
+            else apply<'*'>(x, y, v);
+            break;
+        default:
+            if (!numbers) {
+                verb = "divide";
+            } else if (!apply<'/'>(x, y, v)) {
+                error = "Runtime error: Division by zero at line " + std::to_string(line);
+                return false;
+            }
+            break;
+    }
+    if (verb) {
+        error = std::string("Runtime error: Cannot ") + verb + " non-numeric values at line " + std::to_string(line);
         return false;
     }
+    out.setInt(v);
+    return true;
 }
 
-// Evaluate an AST node and return the resulting value
-std::string Interpreter::eval(ASTNode* node) {
-    if (!node) return "";
+void Interpreter::execute(const Bytecode& bc) {
+    program = &bc;
+    if (globals.size() < symbols.size()) globals.resize(symbols.size());
+    frame.assign(bc.registers, Value());
+    for (size_t i = 0; i < bc.variables.size(); ++i) frame[i] = globals[bc.variables[i]];
+    std::copy(bc.constants.begin(), bc.constants.end(), frame.begin() + bc.constantBase());
+
+    Value* r = frame.data();
+    const BcInstr* code = bc.code.data();
+    const BcInstr* ip = code;
+    const Value::Kind INT = Value::Kind::Int, NONE = Value::Kind::None;
 
-    // literals
-    if (node->type == "number") return node->value;
-    if (node->type == "string") return node->value;
+#define LINE static_cast<int>(bc.lines[ip - code])
+#define SET_INT(reg, v) r[reg].setInt(v)
 
-    if (node->type == "variable") {
-        if (variables.find(node->name) == variables.end())
-            throw std::runtime_error("Runtime error: Undefined variable '" + node->name + "' at line " + std::to_string(node->line));
-        return variables[node->name];
+#if VM_COMPUTED_GOTO
+    static void* const LABELS[] = {
+#define BYTECODE_LABEL(name) &&op_##name,
+        BYTECODE_OPS(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+    };
+#define CASE(name) op_##name:
+#define DISPATCH() goto* LABELS[static_cast<int>(ip->op)]
+#define NEXT()  \
+    do {        \
+        ++ip;   \
+        DISPATCH(); \
+    } while (0)
+    DISPATCH();
+#else
+#define CASE(name) case BcOp::name:
+#define DISPATCH() continue
+#define NEXT()  \
+    {           \
+        ++ip;   \
+        continue; \
     }
+    for (;;) {
+    switch (ip->op) {
+#endif
 
-    if (node->type == "binop") {
-        std::string left = eval(node->left);
-        std::string right = eval(node->right);
-        std::string op = node->op;
-
-        int li, ri;
-        bool leftIsNum = tryParseInt(left, li);
-        bool rightIsNum = tryParseInt(right, ri);
-
-        if (op == "+") {
-            // if both numeric => arithmetic; else concatenate (number converted to string if needed)
-            if (leftIsNum && rightIsNum) {
-                return std::to_string(li + ri);
-            } else {
-                return left + right;
-            }
+    // a = b op c
+#define BINARY(name, OP)                                                             \
+    CASE(name) {                                                                     \
+        const Value &x = r[ip->b], &y = r[ip->c];                                    \
+        int64_t v;                                                                   \
+        if (x.kind == INT && y.kind == INT && apply<OP>(x.i, y.i, v)) {              \
+            SET_INT(ip->a, v);                                                       \
+            NEXT();                                                                  \
+        }                                                                            \
+        if (!arith(OP, x, y, ip->b, ip->c, LINE, r[ip->a])) goto fail;               \
+        NEXT();                                                                      \
+    }
+    // a = b op k; k is never a zero divisor
+#define BINARY_K(name, OP)                                                           \
+    CASE(name) {                                                                     \
+        const Value& x = r[ip->b];                                                   \
+        int64_t k = static_cast<int32_t>(ip->c), v = 0;                                 \
+        if (x.kind == INT) {                                                         \
+            apply<OP>(x.i, k, v);                                                    \
+            SET_INT(ip->a, v);                                                       \
+            NEXT();                                                                  \
+        }                                                                            \
+        if (!arith(OP, x, Value::integer(k), ip->b, UINT32_MAX, LINE, r[ip->a])) goto fail; \
+        NEXT();                                                                      \
+    }
+    // a = (b op1 c) op2 d
+#define FUSED(name, OP1, OP2)                                                        \
+    CASE(name) {                                                                     \
+        const Value &x = r[ip->b], &y = r[ip->c], &z = r[ip->d];                     \
+        int64_t t, v;                                                                \
+        if (x.kind == INT && y.kind == INT && z.kind == INT && apply<OP1>(x.i, y.i, t) && \
+            apply<OP2>(t, z.i, v)) {                                                 \
+            SET_INT(ip->a, v);                                                       \
+            NEXT();                                                                  \
+        }                                                                            \
+        Value partial;                                                               \
+        if (!arith(OP1, x, y, ip->b, ip->c, LINE, partial) ||                        \
+            !arith(OP2, partial, z, UINT32_MAX, ip->d, LINE, r[ip->a]))              \
+            goto fail;                                                               \
+        NEXT();                                                                      \
+    }
+#define FUSED_ROW(first, OP1)                                                        \
+    FUSED(first##Add, OP1, '+') FUSED(first##Sub, OP1, '-') FUSED(first##Mul, OP1, '*') FUSED(first##Div, OP1, '/')
+
+    CASE(Move) {
+        const Value& x = r[ip->b];
+        if (x.kind == INT) {
+            SET_INT(ip->a, x.i);
+            NEXT();
         }
-        if (op == "-") {
-            if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot subtract non-numeric values at line " + std::to_string(node->line));
-            return std::to_string(li - ri);
+        if (x.kind == NONE) {
+            undefined(ip->b, LINE);
+            goto fail;
         }
-        if (op == "*") {
-            if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot multiply non-numeric values at line " + std::to_string(node->line));
-            return std::to_string(li * ri);
+        r[ip->a] = x;
+        NEXT();
+    }
+    CASE(Check) {
+        if (r[ip->a].kind == NONE) {
+            undefined(ip->a, LINE);
+            goto fail;
         }
-        if (op == "/") {
-            if (!leftIsNum || !rightIsNum) throw std::runtime_error("Runtime error: Cannot divide non-numeric values at line " + std::to_string(node->line));
-            if (ri == 0) throw std::runtime_error("Runtime error: Division by zero at line " + std::to_string(node->line));
-            return std::to_string(li / ri);
+        NEXT();
+    }
+    BINARY(Add, '+')
+    BINARY(Sub, '-')
+    BINARY(Mul, '*')
+    BINARY(Div, '/')
+    BINARY_K(AddK, '+')
+    BINARY_K(SubK, '-')
+    BINARY_K(MulK, '*')
+    BINARY_K(DivK, '/')
+    FUSED_ROW(Add, '+')
+    FUSED_ROW(Sub, '-')
+    FUSED_ROW(Mul, '*')
+    FUSED_ROW(Div, '/')
+    CASE(Concat) {
+        const Value &x = r[ip->b], &y = r[ip->c];
+        if (x.kind == NONE) {
+            undefined(ip->b, LINE);
+            goto fail;
         }
-
-        throw std::runtime_error("Runtime error: Unknown operator '" + op + "' at line " + std::to_string(node->line));
+        if (y.kind == NONE) {
+            undefined(ip->c, LINE);
+            goto fail;
+        }
+        Value joined = Value::concat(x, y);
+        r[ip->a] = std::move(joined);
+        NEXT();
     }
-
-    if (node->type == "assign") {
-        std::string val;
-        try {
-            val = eval(node->left);
-        } catch (const std::exception& e) {
-            // Add line context if the inner exception doesn't have it
-            throw;
+    CASE(Print) {
+        const Value& x = r[ip->a];
+        if (x.kind == NONE) {
+            undefined(ip->a, LINE);
+            goto fail;
+        }
+        if (x.kind == INT) {
+            char digits[24];
+            rt_write_line(digits, std::to_chars(digits, digits + sizeof digits, x.i).ptr - digits);
+        } else {
+            rt_write_line(x.text().data(), static_cast<int64_t>(x.text().size()));
         }
-        variables[node->name] = val;
-        return val;
+        NEXT();
+    }
+    CASE(Read) {
+        int64_t length = 0;
+        const char* line = rt_read_line(&length);
+        r[ip->a] = Value::string(line ? std::string_view(line, static_cast<size_t>(length)) : std::string_view());
+        NEXT();
+    }
+    CASE(Halt) {
+        goto done;
     }
 
-    if (node->type == "cin") {
-        std::string input;
-        if (!std::getline(std::cin, input)) input = "";
-        variables[node->name] = input;
-        return input;
+#if !VM_COMPUTED_GOTO
     }
+#endif
 
-    if (node->type == "cout") {
-        std::string val;
-        try {
-            val = eval(node->left);
-        } catch (const std::exception& e) {
-            throw;
-        }
-        std::cout << val << std::endl;
-        return val;
+fail: {
+    // Print error message and continue with next statement
+    rt_write_error(error.data(), static_cast<int64_t>(error.size()));
+    uint32_t at = static_cast<uint32_t>(ip - code);
+    ip = code + *std::upper_bound(bc.statements.begin(), bc.statements.end(), at);
+#if VM_COMPUTED_GOTO
+    DISPATCH();
+#endif
+}
+#if !VM_COMPUTED_GOTO
     }
+#endif
+
+done:
+    rt_flush();
+    for (size_t i = 0; i < bc.variables.size(); ++i) globals[bc.variables[i]] = std::move(frame[i]);
 
-    return "";
+#undef FUSED_ROW
+#undef FUSED
+#undef BINARY_K
+#undef BINARY
+#undef NEXT
+#undef DISPATCH
+#undef CASE
+#undef SET_INT
+#undef LINE
 }
 
 void Interpreter::execute(const std::vector<ASTNode*>& nodes) {
-    for (auto node : nodes) {
-        try {
-            eval(node);
-        } catch (const std::exception& e) {
-            // Print error message and continue with next node
-            std::cerr << e.what() << std::endl;
-        }
-    }
+    execute(FlatAST::fromTree(nodes));
+}
+
+void Interpreter::execute(const FlatAST& ast) {
+    SemanticAnalyzer analyzer(symbols);
+    execute(compileBytecode(ast, symbols, analyzer.resolve(ast)));
+}
+
+void Interpreter::execute(const IRProgram& ir) {
+    execute(compileBytecode(ir, symbols));
 }
@@ -1,108 +1,292 @@
 #include "ir.h"
 #include "parser.h"
+#include "semantic.h"
 #include <vector>
 #include <string>
 #include <sstream> //
-#include <functional> // <--- added to fix std::function compile error
+#include <utility>
 
-// Helper to create temporary names
-static std::string makeTemp(int n) {
-    return std::string("t") + std::to_string(n);
+const char* irOpName(IROp op) {
+    switch (op) {
+        case IROp::Mov: return "MOV";
+        case IROp::Load: return "LOAD";
+        case IROp::Store: return "STORE";
+        case IROp::Print: return "PRINT";
+        case IROp::Read: return "READ";
+        case IROp::Add: return "ADD";
+        case IROp::Sub: return "SUB";
+        case IROp::Mul: return "MUL";
+        case IROp::Div: return "DIV";
+        case IROp::IAdd: return "IADD";
+        case IROp::ISub: return "ISUB";
+        case IROp::IMul: return "IMUL";
+        case IROp::IDiv: return "IDIV";
+        case IROp::Concat: return "CONCAT";
+        case IROp::Nop: return "NOP";
+    }
+    return "?";
+}
+
+std::string operandText(const IRProgram& ir, Operand o, const SymbolTable& symbols) {
+    switch (o.kind) {
+        case OperandKind::None: return "";
+        case OperandKind::Temp: return "t" + std::to_string(o.id);
+        case OperandKind::Var: return symbols.name(o.id);
+        case OperandKind::Int: return std::to_string(ir.intValue(o));
+        case OperandKind::Str: return "\"" + symbols.name(o.id) + "\"";
+    }
+    return "";
+}
+
+void printIR(const IRProgram& ir, const SymbolTable& symbols, std::ostream& out) {
+    size_t n = 0;
+    for (uint32_t i = 0; i <= ir.code.size(); ++i) {
+        for (; n < ir.notes.size() && ir.notes[n].before == i; ++n) out << ir.notes[n].text << "\n";
+        if (i == ir.code.size()) break;
+
+        const IRInstruction& ins = ir.code[i];
+        out << irOpName(ins.op);
+        switch (ins.op) {
+            case IROp::Print:
+                out << " " << operandText(ir, ins.arg1(), symbols);
+                break;
+            case IROp::Read:
+            case IROp::Nop:
+                break;
+            case IROp::Mov:
+            case IROp::Load:
+            case IROp::Store:
+                out << " " << operandText(ir, ins.arg1(), symbols) << " -> " << operandText(ir, ins.result(), symbols);
+                break;
+            default:
+                out << " " << operandText(ir, ins.arg1(), symbols) << " " << operandText(ir, ins.arg2(), symbols)
+                    << " -> " << operandText(ir, ins.result(), symbols);
+                break;
+        }
+        out << "\n";
+    }
+}
+
+// normalize operator tokens to IR ops, typed for operands of types l and r
+static IROp irOpFor(char op, ValueType l, ValueType r) {
+    bool ints = l == ValueType::Int && r == ValueType::Int;
+    switch (op) {
+        case '+':
+            if (ints) return IROp::IAdd;
+            return l == ValueType::String || r == ValueType::String ? IROp::Concat : IROp::Add;
+        case '-': return ints ? IROp::ISub : IROp::Sub;
+        case '*': return ints ? IROp::IMul : IROp::Mul;
+        default: return ints ? IROp::IDiv : IROp::Div;
+    }
+}
+
+static std::string divByZeroNote(int line) {
+    return "; ERROR: division by zero at line " + std::to_string(line);
 }
 
+IRGenerator::IRGenerator(const SymbolTable& symbols) : symbols(symbols) {}
+
 //as input AST and IR as output
-std::vector<IRInstruction> IRGenerator::generate(const std::vector<ASTNode*>& nodes) {
-    std::vector<IRInstruction> ir;
-    int tmpCount = 1;
+IRProgram IRGenerator::generate(const std::vector<ASTNode*>& nodes) {
+    IRProgram ir;
+    uint32_t tmpCount = 1;
 
-    // forward declare lambda
-    std::function<std::string(ASTNode*)> genExpr;
+    // post-order walk with explicit stacks: (node, children done) pairs
+    // still to visit and the temps of finished sub-expressions
+    std::vector<std::pair<ASTNode*, bool>> work;
+    std::vector<Operand> temps;
 
-    genExpr = [&](ASTNode* node) -> std::string {
-        if (!node) return "";
+    auto genExpr = [&](ASTNode* root) -> Operand {
+        if (!root) return Operand();
+        work.clear();
+        temps.clear();
+        work.push_back({root, false});
 
-        if (node->type == "number") {
-            std::string t = makeTemp(tmpCount++);
-            ir.push_back(IRInstruction{"MOV", node->value, "", t});
-            return t;
-        }
+        while (!work.empty()) {
+            auto [node, expanded] = work.back();
+            work.pop_back();
 
-        if (node->type == "string") {
-            // store string literal including quotes so it is clear in IR
-            std::string literal = "\"" + node->value + "\"";
-            std::string t = makeTemp(tmpCount++);
-            ir.push_back(IRInstruction{"MOV", literal, "", t});
-            return t;
-        }
+            switch (node->kind) {
+                case NodeKind::Number: {
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Mov, t, ir.imm(node->number)}, node->line);
+                    temps.push_back(t);
+                    break;
+                }
 
-        if (node->type == "variable") {
-            // read variable into a temp
-            std::string t = makeTemp(tmpCount++);
-            ir.push_back(IRInstruction{"LOAD", node->name, "", t});
-            return t;
-        }
+                case NodeKind::String: {
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Mov, t, Operand::str(node->symbol)}, node->line);
+                    temps.push_back(t);
+                    break;
+                }
 
-        if (node->type == "binop") {
-            std::string L = genExpr(node->left);
-            std::string R = genExpr(node->right);
-            std::string t = makeTemp(tmpCount++);
-
-            std::string op = node->op;
-            // normalize operator tokens to IR ops
-            if (op == "+") op = "ADD";
-            else if (op == "-") op = "SUB";
-            else if (op == "*") op = "MUL";
-            else if (op == "/") op = "DIV";
-
-            ir.push_back(IRInstruction{op, L, R, t});
-
-            // if we see DIV with literal 0 on right, also add an ERROR node to document it
-            if ((op == "DIV") && node->right && node->right->type == "number" && node->right->value == "0") {
-                std::ostringstream msg;
-                msg << "; ERROR: division by zero at line " << node->line;
-                ir.push_back(IRInstruction{msg.str(), "", "", ""});
-            }
+                case NodeKind::Variable: {
+                    // read variable into a temp
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Load, t, Operand::var(node->symbol)}, node->line);
+                    temps.push_back(t);
+                    break;
+                }
 
-            return t;
-        }
+                case NodeKind::BinOp: {
+                    if (!expanded) {
+                        // operands first, left before right
+                        work.push_back({node, true});
+                        work.push_back({node->right, false});
+                        work.push_back({node->left, false});
+                        break;
+                    }
+                    Operand R = temps.back();
+                    temps.pop_back();
+                    Operand L = temps.back();
+                    temps.pop_back();
+                    Operand t = Operand::temp(tmpCount++);
+
+                    ir.emit({irOpFor(node->op, node->left->type, node->right->type), t, L, R}, node->line);
+
+                    // if we see DIV with literal 0 on right, also add an ERROR note to document it
+                    if (node->op == '/' && node->right && node->right->kind == NodeKind::Number && node->right->number == 0) {
+                        ir.note(divByZeroNote(node->line));
+                    }
 
-        // fallback
-        return std::string();
+                    temps.push_back(t);
+                    break;
+                }
+
+                default:
+                    // fallback
+                    temps.push_back(Operand());
+                    break;
+            }
+        }
+        return temps.back();
     };
 
     for (ASTNode* stmt : nodes) {
         if (!stmt) continue;
 
-        if (stmt->type == "assign") {
-            // evaluate RHS into a temp (or variable result)
-            std::string rhs = genExpr(stmt->left);
-            // store temp into the variable
-            ir.push_back(IRInstruction{"STORE", rhs, "", stmt->name});
-            continue;
+        switch (stmt->kind) {
+            case NodeKind::Assign: {
+                // evaluate RHS into a temp (or variable result)
+                Operand rhs = genExpr(stmt->left);
+                // store temp into the variable
+                ir.emit({IROp::Store, Operand::var(stmt->symbol), rhs}, stmt->line);
+                continue;
+            }
+
+            case NodeKind::Cout: {
+                // evaluate expression and print either variable name or temp
+                Operand rhs = genExpr(stmt->left);
+                if (stmt->left && stmt->left->kind == NodeKind::Variable) {
+                    // print variable directly (LOAD would be emitted elsewhere)
+                    ir.emit({IROp::Print, Operand(), Operand::var(stmt->left->symbol)}, stmt->left->line);
+                } else {
+                    ir.emit({IROp::Print, Operand(), rhs}, stmt->line);
+                }
+                continue;
+            }
+
+            case NodeKind::Cin:
+                // read into variable (represent as a special STORE from input)
+                ir.emit({IROp::Read, Operand::var(stmt->symbol)}, stmt->line);
+                continue;
+
+            default:
+                break;
         }
 
-        if (stmt->type == "cout") {
-            // evaluate expression and print either variable name or temp
-            std::string rhs = genExpr(stmt->left);
-            if (stmt->left && stmt->left->type == "variable") {
-                // print variable directly (LOAD would be emitted elsewhere)
-                ir.push_back(IRInstruction{"PRINT", stmt->left->name, "", ""});
-            } else {
-                ir.push_back(IRInstruction{"PRINT", rhs, "", ""});
+        std::ostringstream note;
+        note << "; UNHANDLED_STMT type=" << nodeKindName(stmt->kind) << " line=" << stmt->line;
+        ir.note(note.str());
+    }
+
+    ir.temps = tmpCount - 1;
+    return ir;
+}
+
+// Same IR as the tree version: post-order node layout means walking a
+// statement's nodes in array order visits operands before their operator.
+IRProgram IRGenerator::generate(const FlatAST& ast) {
+    IRProgram ir;
+    std::vector<Operand> operands; // temps of evaluated sub-expressions
+    uint32_t tmpCount = 1;
+    std::vector<ValueType> types = SemanticAnalyzer(symbols).resolve(ast).types;
+
+    for (size_t s = 0; s < ast.statements.size(); ++s) {
+        NodeIndex root = ast.statements[s];
+        operands.clear();
+
+        for (NodeIndex i = ast.begin(s); i < root; ++i) {
+            switch (ast.kind[i]) {
+                case NodeKind::Number: {
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Mov, t, ir.imm(ast.payload[i])}, ast.line[i]);
+                    operands.push_back(t);
+                    break;
+                }
+                case NodeKind::String: {
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Mov, t, Operand::str(static_cast<Symbol>(ast.payload[i]))}, ast.line[i]);
+                    operands.push_back(t);
+                    break;
+                }
+                case NodeKind::Variable: {
+                    Operand t = Operand::temp(tmpCount++);
+                    ir.emit({IROp::Load, t, Operand::var(static_cast<Symbol>(ast.payload[i]))}, ast.line[i]);
+                    operands.push_back(t);
+                    break;
+                }
+                case NodeKind::BinOp: {
+                    Operand R = operands.back();
+                    operands.pop_back();
+                    Operand L = operands.back();
+                    operands.pop_back();
+                    Operand t = Operand::temp(tmpCount++);
+                    char op = static_cast<char>(ast.payload[i]);
+                    NodeIndex right = ast.rhs[i];
+                    ir.emit({irOpFor(op, types[ast.lhs[i]], types[right]), t, L, R}, ast.line[i]);
+
+                    if (op == '/' && ast.kind[right] == NodeKind::Number && ast.payload[right] == 0) {
+                        ir.note(divByZeroNote(ast.line[i]));
+                    }
+                    operands.push_back(t);
+                    break;
+                }
+                default:
+                    break;
             }
-            continue;
         }
 
-        if (stmt->type == "cin") {
-            // read into variable (represent as a special STORE from input)
-            ir.push_back(IRInstruction{"READ", "", "", stmt->name});
-            continue;
+        Symbol name = static_cast<Symbol>(ast.payload[root]);
+        switch (ast.kind[root]) {
+            case NodeKind::Assign:
+                ir.emit({IROp::Store, Operand::var(name), operands.back()}, ast.line[root]);
+                continue;
+
+            case NodeKind::Cout: {
+                NodeIndex value = ast.lhs[root];
+                if (ast.kind[value] == NodeKind::Variable) {
+                    ir.emit({IROp::Print, Operand(), Operand::var(static_cast<Symbol>(ast.payload[value]))}, ast.line[value]);
+                } else {
+                    ir.emit({IROp::Print, Operand(), operands.back()}, ast.line[root]);
+                }
+                continue;
+            }
+
+            case NodeKind::Cin:
+                ir.emit({IROp::Read, Operand::var(name)}, ast.line[root]);
+                continue;
+
+            default:
+                break;
         }
 
         std::ostringstream note;
-        note << "; UNHANDLED_STMT type=" << stmt->type << " line=" << stmt->line;
-        ir.push_back(IRInstruction{note.str(), "", "", ""});
+        note << "; UNHANDLED_STMT type=" << nodeKindName(ast.kind[root]) << " line=" << ast.line[root];
+        ir.note(note.str());
     }
 
+    ir.temps = tmpCount - 1;
     return ir;
 }
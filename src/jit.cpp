@@ -0,0 +1,326 @@
+#include "jit.h"
+#include "x86.h"
+#include "runtime.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// the lowering follows the System V calling convention
+#if defined(__x86_64__) && !defined(_WIN32)
+#define MINI_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// The lowering as machine code. Code goes into two buffers, the main body
+// and the cold paths after it; everything that depends on where things end
+// up (jumps, and RIP-relative references to the data) is a fixup patched
+// once the layout is known. Jumps always take a 32-bit displacement.
+class ByteEmitter : public X86Emitter {
+public:
+    enum Target : uint8_t { LABEL, DATA, VAR, NAME };
+    struct Fixup {
+        uint8_t section;
+        Target kind;
+        uint8_t tail;    // instruction bytes after the displacement
+        uint32_t at;     // offset of the displacement in its section
+        uint32_t target; // label, data offset, or variable number
+    };
+    static constexpr size_t HELPERS = 8;
+
+    // Machine code of one section. Every instruction first makes room() for
+    // the longest one, then its bytes go in unchecked.
+    struct Code {
+        std::vector<uint8_t> bytes;
+        size_t size = 0;
+        void room() {
+            if (bytes.size() - size < 16) bytes.resize(std::max<size_t>(bytes.size() * 2, 4096));
+        }
+    };
+
+    Code sections[2];
+    std::vector<Fixup> fixups;
+    std::vector<std::pair<uint8_t, uint32_t>> labels; // section, offset
+    std::vector<uint8_t> data;                        // helper table, then string objects
+
+private:
+    const SymbolTable& symbols;
+    Code* cur = &sections[0];
+    uint8_t section_ = 0;
+    std::vector<uint32_t> stringAt; // per Symbol: data offset + 1, 0 if not there yet
+
+    static int n(X86Reg r) { return static_cast<int>(r); }
+    void byte(int b) { cur->bytes[cur->size++] = static_cast<uint8_t>(b); }
+    void imm32(int64_t v) {
+        uint32_t u = static_cast<uint32_t>(v);
+        for (int i = 0; i < 4; ++i) byte(u >> (8 * i) & 0xff);
+    }
+    static bool fits8(int64_t v) { return v == static_cast<int8_t>(v); }
+
+    // REX prefix for the ModRM reg field `reg` and the register `rm` (a
+    // base register or a register operand); left out when it would be 0x40
+    void rex(bool wide, int reg, int rm) {
+        int p = 0x40 | (wide ? 8 : 0) | (reg >> 3) << 2 | (rm >> 3);
+        if (p != 0x40) byte(p);
+    }
+    // data offset of a Str or Big object, the number of a Var or Name
+    uint32_t offsetOf(const X86Arg& a) {
+        if (a.kind != X86Arg::Str && a.kind != X86Arg::Big) return static_cast<uint32_t>(a.value);
+        if (a.kind == X86Arg::Str && stringAt[a.value]) return stringAt[a.value] - 1;
+        // an rt_string: length, numeric (-1: not worked out yet), view (0: bytes follow), value, text
+        std::string text = a.kind == X86Arg::Str ? symbols.name(static_cast<Symbol>(a.value)) : std::to_string(a.value);
+        data.resize((data.size() + 7) & ~size_t(7));
+        uint32_t at = static_cast<uint32_t>(data.size());
+        int64_t length = static_cast<int64_t>(text.size());
+        int32_t header[4] = {-1, 0, 0, 0};
+        data.insert(data.end(), reinterpret_cast<uint8_t*>(&length), reinterpret_cast<uint8_t*>(&length) + 8);
+        data.insert(data.end(), reinterpret_cast<uint8_t*>(header), reinterpret_cast<uint8_t*>(header) + 16);
+        data.insert(data.end(), text.begin(), text.end());
+        data.push_back(0);
+        if (a.kind == X86Arg::Str) stringAt[a.value] = at + 1;
+        return at;
+    }
+    // ModRM (and SIB and displacement) for a memory operand or an address;
+    // `tail` immediate bytes follow
+    void memory(int reg, const X86Arg& a, int tail = 0) {
+        if (a.kind == X86Arg::Slot) {
+            int64_t disp = a.value * 8;
+            int mod = disp == 0 ? 0 : fits8(disp) ? 1 : 2;
+            byte(mod << 6 | (reg & 7) << 3 | 4);
+            byte(0x24); // base %rsp, no index
+            if (mod == 1) byte(static_cast<int>(disp) & 0xff);
+            if (mod == 2) imm32(disp);
+            return;
+        }
+        Target kind = a.kind == X86Arg::Var ? VAR : a.kind == X86Arg::Name ? NAME : DATA;
+        byte((reg & 7) << 3 | 5); // RIP-relative
+        displacement(kind, offsetOf(a), tail);
+    }
+    void displacement(Target kind, uint32_t target, int tail = 0) {
+        fixups.push_back({section_, kind, static_cast<uint8_t>(tail), static_cast<uint32_t>(cur->size), target});
+        imm32(0);
+    }
+    // opcode with a ModRM reg field and a register or memory r/m operand
+    void op(bool wide, std::initializer_list<int> opcode, int reg, const X86Arg& rm, int tail = 0) {
+        rex(wide, reg, rm.isReg() ? n(rm.r()) : 0);
+        for (int b : opcode) byte(b);
+        if (rm.isReg()) byte(0xc0 | (reg & 7) << 3 | (n(rm.r()) & 7));
+        else memory(reg, rm, tail);
+    }
+    void jump(std::initializer_list<int> opcode, Label l) {
+        for (int b : opcode) byte(b);
+        displacement(LABEL, l);
+    }
+
+public:
+    ByteEmitter(const SymbolTable& symbols, size_t instructions)
+        : data(HELPERS * 8, 0), symbols(symbols), stringAt(symbols.size(), 0) {
+        // about what arithmetic takes, in the body and in its slow path
+        sections[0].bytes.resize(instructions * 32);
+        sections[1].bytes.resize(instructions * 24);
+        labels.reserve(instructions * 2);
+        fixups.reserve(instructions * 4);
+    }
+
+    void section(bool cold) override {
+        section_ = cold ? 1 : 0;
+        cur = &sections[section_];
+    }
+    Label label() override {
+        labels.push_back({0, UINT32_MAX});
+        return static_cast<Label>(labels.size() - 1);
+    }
+    void bind(Label l) override { labels[l] = {section_, static_cast<uint32_t>(cur->size)}; }
+
+    void movq(X86Arg dst, X86Arg src) override {
+        cur->room();
+        if (!dst.isReg()) {
+            if (src.isReg()) op(true, {0x89}, n(src.r()), dst);
+            else op(true, {0xc7}, 0, dst, 4), imm32(src.value);
+        } else if (src.kind == X86Arg::Imm) {
+            int r = n(dst.r());
+            if (src.value == static_cast<int32_t>(src.value)) {
+                op(true, {0xc7}, 0, dst), imm32(src.value);
+            } else if (src.value == static_cast<uint32_t>(src.value)) {
+                rex(false, 0, r), byte(0xb8 + (r & 7)), imm32(src.value); // zero-extended
+            } else {
+                rex(true, 0, r), byte(0xb8 + (r & 7));
+                for (int i = 0; i < 8; ++i) byte(static_cast<uint64_t>(src.value) >> (8 * i) & 0xff);
+            }
+        } else {
+            bool address = src.kind == X86Arg::Str || src.kind == X86Arg::Big || src.kind == X86Arg::Name;
+            op(true, {address ? 0x8d : 0x8b}, n(dst.r()), src);
+        }
+    }
+    void aluq(Alu alu, X86Reg dst, X86Arg src) override {
+        cur->room();
+        static const int REGISTER_FORM[] = {0x89, 0x01, 0x29, 0, 0x21, 0x09}; // op r/m64, r64
+        static const int EXTENSION[] = {0, 0, 5, 0, 4, 1};                    // 0x81 /n
+        X86Arg d = X86Arg::reg(dst);
+        if (src.isReg()) {
+            if (alu == Alu::Imul) op(true, {0x0f, 0xaf}, n(dst), src);
+            else op(true, {REGISTER_FORM[static_cast<int>(alu)]}, n(src.r()), d);
+        } else if (alu == Alu::Mov) {
+            op(true, {0xc7}, 0, d), imm32(src.value);
+        } else if (alu == Alu::Imul) {
+            if (fits8(src.value)) op(true, {0x6b}, n(dst), d), byte(static_cast<int>(src.value) & 0xff);
+            else op(true, {0x69}, n(dst), d), imm32(src.value);
+        } else {
+            int ext = EXTENSION[static_cast<int>(alu)];
+            if (fits8(src.value)) op(true, {0x83}, ext, d), byte(static_cast<int>(src.value) & 0xff);
+            else op(true, {0x81}, ext, d), imm32(src.value);
+        }
+    }
+    void testq(X86Reg a, X86Reg b) override { cur->room(), op(true, {0x85}, n(b), X86Arg::reg(a)); }
+    void testLowBit(X86Reg r) override { cur->room(), op(false, {0xf6}, 0, X86Arg::reg(r)), byte(1); }
+    void cmpq(X86Reg r, int32_t imm) override {
+        cur->room();
+        if (fits8(imm)) op(true, {0x83}, 7, X86Arg::reg(r)), byte(imm & 0xff);
+        else op(true, {0x81}, 7, X86Arg::reg(r)), imm32(imm);
+    }
+    void sarq1(X86Reg r) override { cur->room(), op(true, {0xd1}, 7, X86Arg::reg(r)); }
+    void cqto() override { cur->room(), byte(0x48), byte(0x99); }
+    void idivq(X86Reg r) override { cur->room(), op(true, {0xf7}, 7, X86Arg::reg(r)); }
+    void tag(X86Reg r) override {
+        cur->room();
+        // leaq 1(r,r), r: ModRM with a SIB byte and an 8-bit displacement
+        int x = n(r);
+        byte(0x48 | (x >> 3) << 2 | (x >> 3) << 1 | (x >> 3));
+        byte(0x8d);
+        byte(0x44 | (x & 7) << 3);
+        byte((x & 7) << 3 | (x & 7));
+        byte(1);
+    }
+    void jmp(Label l) override { cur->room(), jump({0xe9}, l); }
+    void jz(Label l) override { cur->room(), jump({0x0f, 0x84}, l); }
+    void jo(Label l) override { cur->room(), jump({0x0f, 0x80}, l); }
+    void call(Helper h) override {
+        cur->room();
+        // call *slot(%rip), through the helper table at the start of the data
+        byte(0xff);
+        byte(2 << 3 | 5);
+        displacement(DATA, static_cast<uint32_t>(h) * 8);
+    }
+    void pushq(X86Reg r) override { cur->room(), rex(false, 0, n(r)), byte(0x50 + (n(r) & 7)); }
+    void popq(X86Reg r) override { cur->room(), rex(false, 0, n(r)), byte(0x58 + (n(r) & 7)); }
+    void addRsp(int32_t bytes) override {
+        cur->room();
+        X86Arg rsp = X86Arg::reg(X86Reg::RSP);
+        int ext = bytes < 0 ? 5 : 0; // subq or addq
+        int64_t v = bytes < 0 ? -int64_t(bytes) : bytes;
+        if (fits8(v)) op(true, {0x83}, ext, rsp), byte(static_cast<int>(v));
+        else op(true, {0x81}, ext, rsp), imm32(v);
+    }
+    void ret() override { cur->room(), byte(0xc3); }
+};
+
+#ifdef MINI_JIT
+size_t pageAligned(size_t n) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (n + page - 1) / page * page;
+}
+#endif
+
+}
+
+JitProgram::~JitProgram() {
+    release();
+}
+
+void JitProgram::release() {
+#ifdef MINI_JIT
+    if (memory) munmap(memory, mapped);
+#endif
+    memory = nullptr;
+    mapped = code = 0;
+}
+
+bool JitProgram::compile(const IRProgram& ir, const SymbolTable& symbols, std::string& error, int registers) {
+    release();
+#ifndef MINI_JIT
+    (void)ir, (void)symbols, (void)registers;
+    error = "the JIT needs x86-64 with the System V ABI";
+    return false;
+#else
+    RegisterAllocation ra = RegisterAllocation::build(ir, std::min(registers, X86CodeGenerator::REGISTERS), 0);
+    lastStats = ra.stats;
+    ByteEmitter out(symbols, ir.code.size());
+    std::vector<Symbol> vars = lowerToX86(ir, ra, out);
+
+    // layout: main body, cold paths, then on fresh pages the data with the
+    // variable words and names after it
+    const ByteEmitter::Code& hot = out.sections[0];
+    const ByteEmitter::Code& cold = out.sections[1];
+    code = hot.size + cold.size;
+    size_t dataStart = pageAligned(code);
+    size_t varsAt = (out.data.size() + 7) & ~size_t(7);
+    std::vector<size_t> nameAt(vars.size());
+    size_t end = varsAt + vars.size() * 8;
+    for (size_t v = 0; v < vars.size(); ++v) {
+        nameAt[v] = end;
+        end += symbols.name(vars[v]).size() + 1;
+    }
+    size_t size = dataStart + pageAligned(end);
+    if (size > INT32_MAX) {
+        error = "program too large for 32-bit displacements";
+        return false;
+    }
+
+    void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) {
+        error = std::string("cannot map memory: ") + std::strerror(errno);
+        return false;
+    }
+    unsigned char* base = static_cast<unsigned char*>(m);
+    std::memcpy(base, hot.bytes.data(), hot.size);
+    std::memcpy(base + hot.size, cold.bytes.data(), cold.size);
+    unsigned char* data = base + dataStart;
+    std::memcpy(data, out.data.data(), out.data.size());
+    const void* helpers[ByteEmitter::HELPERS] = {
+        reinterpret_cast<const void*>(&rt_add),       reinterpret_cast<const void*>(&rt_sub),
+        reinterpret_cast<const void*>(&rt_mul),       reinterpret_cast<const void*>(&rt_div),
+        reinterpret_cast<const void*>(&rt_undefined), reinterpret_cast<const void*>(&rt_print),
+        reinterpret_cast<const void*>(&rt_read),      reinterpret_cast<const void*>(&rt_concat)};
+    std::memcpy(data, helpers, sizeof helpers);
+    for (size_t v = 0; v < vars.size(); ++v) {
+        const std::string& name = symbols.name(vars[v]);
+        std::memcpy(data + nameAt[v], name.c_str(), name.size() + 1);
+    }
+
+    size_t sectionStart[2] = {0, hot.size};
+    for (const ByteEmitter::Fixup& f : out.fixups) {
+        size_t at = sectionStart[f.section] + f.at;
+        size_t target = 0;
+        switch (f.kind) {
+            case ByteEmitter::LABEL:
+                target = sectionStart[out.labels[f.target].first] + out.labels[f.target].second;
+                break;
+            case ByteEmitter::DATA: target = dataStart + f.target; break;
+            case ByteEmitter::VAR: target = dataStart + varsAt + f.target * 8; break;
+            case ByteEmitter::NAME: target = dataStart + nameAt[f.target]; break;
+        }
+        int32_t disp = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4 + f.tail));
+        std::memcpy(base + at, &disp, 4);
+    }
+
+    if (mprotect(base, dataStart, PROT_READ | PROT_EXEC) != 0) {
+        error = std::string("cannot make code executable: ") + std::strerror(errno);
+        munmap(base, size);
+        return false;
+    }
+    memory = base;
+    mapped = size;
+    return true;
+#endif
+}
+
+void JitProgram::run() const {
+    if (!memory) return;
+    reinterpret_cast<int (*)()>(memory)();
+    rt_flush();
+}
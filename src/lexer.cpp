@@ -1,46 +1,48 @@
 #include "lexer.h"
+#include "scan.h"
 #include <cctype>
 #include <stdexcept>
+#include <string>
 
-Lexer::Lexer(const std::string& text) : text(text), pos(0), line(1) {}
+Lexer::Lexer(std::string_view text, SymbolTable& symbols, int firstLine)
+    : text(text), symbols(&symbols), pos(0), line(firstLine) {}
 
 char Lexer::currentChar() {
     return pos < text.size() ? text[pos] : '\0';
 }
 
+// The loops below hand each run (whitespace, comment body, identifier, ...)
+// to the vectorized scanners in scan.h, which also count the newlines inside
+// the run, instead of classifying one character at a time.
 void Lexer::skipWhitespaceAndComments() {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
     while (pos < text.size()) {
         char c = text[pos];
         // whitespace
-        if (std::isspace(static_cast<unsigned char>(c))) {
-            if (c == '\n') line++;
-            pos++;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            pos = scan::skipSpace(begin + pos, end, line) - begin;
             continue;
         }
 
         // Single-line comment //
         if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '/') {
-            pos += 2;
-            while (pos < text.size() && text[pos] != '\n') pos++;
+            pos = scan::findByte(begin + pos + 2, end, '\n') - begin;
             continue;
         }
 
         // Multi-line comment /* ... */
         if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '*') {
-            pos += 2;
-            bool closed = false;
-            while (pos + 1 < text.size()) {
-                if (text[pos] == '\n') line++;
-                if (text[pos] == '*' && text[pos + 1] == '/') {
-                    pos += 2;
-                    closed = true;
-                    break;
-                }
-                pos++;
-            }
-            if (!closed) {
+            const char* body = begin + pos + 2;
+            const char* close = scan::findCommentClose(body, end);
+            if (close == end) {
+                // count as far as the original char-by-char loop got
+                if (body < end - 1) line += scan::countNewlines(body, end - 1);
+                pos = text.size();
                 throw std::runtime_error("Unterminated comment starting at line " + std::to_string(line));
             }
+            line += scan::countNewlines(body, close);
+            pos = (close + 2) - begin;
             continue;
         }
 
@@ -48,35 +50,30 @@ void Lexer::skipWhitespaceAndComments() {
     }
 }
 
-std::string Lexer::number() {
-    std::string result;
-    while (std::isdigit(static_cast<unsigned char>(currentChar()))) {
-        result += currentChar();
-        pos++;
-    }
-    return result;
+std::string_view Lexer::number() {
+    size_t start = pos;
+    pos = scan::digitEnd(text.data() + pos, text.data() + text.size()) - text.data();
+    return text.substr(start, pos - start);
 }
 //identifier
-std::string Lexer::identifier() {
-    std::string result;
+std::string_view Lexer::identifier() {
+    size_t start = pos;
     // allow letters, digits and underscore; identifiers may start with underscore
-    while (std::isalnum(static_cast<unsigned char>(currentChar())) || currentChar() == '_') {
-        result += currentChar();
-        pos++;
-    }
-    return result;
+    pos = scan::identEnd(text.data() + pos, text.data() + text.size()) - text.data();
+    return text.substr(start, pos - start);
 }
 
-std::string Lexer::stringLiteral() {
-    // supports simple string literal without escape processing
+std::string_view Lexer::stringLiteral() {
+    // supports simple string literal without escape processing, so the
+    // literal's value is exactly the source bytes between the quotes
     pos++; // skip opening "
-    std::string result;
-    while (currentChar() != '"' && currentChar() != '\0') {
-        if (currentChar() == '\n') line++;
-        result += currentChar();
-        pos++;
-    }
-    if (currentChar() == '"') {
+    size_t start = pos;
+    const char* end = text.data() + text.size();
+    const char* close = scan::findByte(text.data() + start, end, '"');
+    line += scan::countNewlines(text.data() + start, close);
+    pos = close - text.data();
+    if (close != end) {
+        std::string_view result = text.substr(start, pos - start);
         pos++; // skip closing "
         return result;
     }
@@ -94,13 +91,17 @@ Token Lexer::getNextToken() {
     }
 
     if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
-        std::string id = identifier();
+        std::string_view id = identifier();
         if (id == "cout") return Token(COUT, id, line);
         if (id == "cin") return Token(CIN, id, line);
-        return Token(IDENTIFIER, id, line);
+        return Token(IDENTIFIER, id, line, symbols->intern(id));
     }
 
-    if (c == '"') return Token(STRING, stringLiteral(), line);
+    if (c == '"') {
+        int startLine = line; // a string token reports the line it starts on
+        std::string_view literal = stringLiteral();
+        return Token(STRING, literal, startLine, symbols->intern(literal));
+    }
 
     // Single-char tokens
     pos++;
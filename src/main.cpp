@@ -1,111 +1,480 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <filesystem>
+#include <memory>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <utility>
 
+#include "source.h"
+#include "context.h"
 #include "lexer.h"
 #include "parser.h"
+#include "flatast.h"
+#include "parallel.h"
+#include "threadpool.h"
+#include "batch.h"
+#include "incremental.h"
+#include "cache.h"
 #include "semantic.h"
 #include "ir.h"
 #include "interpreter.h"
 
 #include "optimizer.h"
 #include "codegen.h"
+#include "x86.h"
+#include "jit.h"
+#include "runtime.h"
 
 namespace fs = std::filesystem;
-//
-int runCompilerOnFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Cannot open file: " << filename << std::endl;
+
+// Command-line options shared by every file compiled in one run
+struct DriverOptions {
+    bool flatAst = false;        // --flat-ast: run the front-end phases over FlatAST
+    ThreadPool* parsePool = nullptr; // --parse-threads N: parse statement chunks in parallel
+    CompileCache* cache = nullptr;   // --cache DIR: reuse earlier compilations of the same source
+    int optLevel = 2;                // -O0, -O1, -O2
+    bool passStats = false;          // --pass-stats: report each optimizer pass on stderr
+    int registers = 8;               // --registers N: size of the register file
+    bool allocStats = false;         // --alloc-stats: report register allocation on stderr
+    std::string native;              // --native OUT: also build an x86-64 executable
+    std::string runtime = "runtime/runtime.c"; // --runtime PATH: linked into native executables
+    bool jit = false;                // --jit: run the optimized IR as machine code
+    bool runIr = false;              // --run-ir: interpret the optimized IR instead of the AST
+    bool strictTypes = false;        // --strict-types: type errors stop the compilation
+};
+
+// Everything printed between parsing and running the program
+static void printCompileOutput(const IRProgram& ir, const IRProgram& optimizedIR,
+                               const std::vector<std::string>& asmCode, const SymbolTable& symbols,
+                               std::ostream& out) {
+    out << "=== Generating IR ===\n";
+    printIR(ir, symbols, out);
+    out << "\n";
+
+    out << "=== Optimizing IR ===\n";
+    printIR(optimizedIR, symbols, out);
+    out << "\n";
+
+    out << "=== Code Generation ===\n";
+    for (auto &line : asmCode) out << line << "\n";
+    out << "\n";
+}
+
+// --pass-stats: one line per pass of the last optimize() call
+static void printPassStats(const Optimizer& opt, std::ostream& err) {
+    err << "[passes] " << opt.rounds() << " rounds\n";
+    for (const PassStats& s : opt.passStats()) {
+        err << "[pass] " << s.name << ": " << s.runs << " runs, " << s.changes << " changed, " << s.removed
+                  << " instructions removed, " << s.milliseconds << " ms\n";
+    }
+}
+
+// --alloc-stats: spills and register pressure of the generated code
+static void printAllocationStats(const AllocationStats& s, std::ostream& err) {
+    err << "[regalloc] " << s.used << " of " << s.registers << " registers used";
+    if (s.scratch) err << " (" << s.scratch << " for spill code)";
+    err << ", max pressure " << s.maxPressure << ", " << s.spilled << " of " << s.intervals
+              << " values spilled: " << s.spillStores << " spills, " << s.reloads << " reloads, "
+              << s.rematerialized << " constants reloaded, " << s.slots << " slots\n";
+}
+
+// --native: lower the optimized IR to x86-64 and link an executable
+static void buildNative(const IRProgram& optimizedIR, const SymbolTable& symbols, const DriverOptions& options,
+                        std::ostream& err) {
+    X86CodeGenerator x86(options.registers);
+    std::string error;
+    if (buildExecutable(x86.generate(optimizedIR, symbols), options.runtime, options.native, error)) {
+        err << "[native] built " << options.native << " (assembly in " << options.native << ".s)\n";
+    } else {
+        err << "[native] " << error << "\n";
+    }
+}
+
+// --jit: encode the optimized IR into executable memory; on failure the
+// program runs in the interpreter instead
+static void compileJit(JitProgram& jit, const IRProgram& optimizedIR, const SymbolTable& symbols,
+                       const DriverOptions& options, std::ostream& err) {
+    std::string error;
+    if (!jit.compile(optimizedIR, symbols, error, options.registers)) {
+        err << "[jit] " << error << "; interpreting instead\n";
+    }
+}
+
+// Cache hit: replay the stored compilation and run its flat AST; none of
+// the compile phases run.
+static void replayCompilation(const CacheEntry& entry, const DriverOptions& options, std::ostream& out,
+                              std::ostream& err) {
+    SymbolTable symbols;
+    for (const auto& name : entry.names) symbols.intern(name);
+
+    err << entry.diagnostics;
+    out << "=== Semantic Analysis ===\n";
+    out << "OK\n\n";
+    printCompileOutput(entry.ir, entry.optimizedIR, entry.assembly, symbols, out);
+    if (!options.native.empty()) buildNative(entry.optimizedIR, symbols, options, err);
+    JitProgram jit;
+    if (options.jit) compileJit(jit, entry.optimizedIR, symbols, options, err);
+
+    out << "=== Running Program ===\n";
+    if (jit.compiled()) {
+        jit.run();
+        return;
+    }
+    Interpreter interpreter(symbols);
+    if (options.runIr) interpreter.execute(entry.optimizedIR);
+    else interpreter.execute(entry.ast);
+}
+
+// Compile `filename` and run it. Listings go to `out`, diagnostics to
+// `err`; the program's own output and runtime errors go where the runtime
+// sends them (runtime.h). Nonzero if it could not be compiled.
+int runCompilerOnFile(const std::string& filename, const DriverOptions& options, std::ostream& out = std::cout,
+                      std::ostream& err = std::cerr) {
+    // map the file once; tokens are views into this mapping
+    SourceFile source;
+    if (!source.open(filename)) {
+        err << "Cannot open file: " << filename << std::endl;
         return 1;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string code = buffer.str();
+    CompileCache::Key key{};
+    if (options.cache) {
+        key = CompileCache::keyFor(source.text(), (options.flatAst ? 1 : 0) | options.optLevel << 1 |
+                                                     static_cast<uint64_t>(options.registers) << 3 |
+                                                     static_cast<uint64_t>(options.strictTypes) << 32);
+        CacheEntry entry;
+        if (options.cache->load(key, entry)) {
+            replayCompilation(entry, options, out, err);
+            return 0;
+        }
+    }
 
     try {
-        Lexer lexer(code);
-        Parser parser(lexer);
-        std::vector<ASTNode*> ast = parser.parse();
+        // identifiers and string literals are interned once, at lex time; the
+        // AST lives in ctx.arena and is released when ctx goes out of scope
+        CompileContext ctx;
+        SymbolTable& symbols = ctx.symbols;
+        std::vector<ASTNode*> ast;
+        // the flat (structure-of-arrays) layout the later phases of
+        // --flat-ast run over; the cache always stores this form
+        FlatAST flat;
+        // the parser writes it directly, without a tree; the parallel
+        // parser builds trees only
+        bool parsedFlat = options.flatAst && !options.parsePool;
+
+        // parse errors are captured when they have to go into the cache
+        std::ostringstream captured;
+        std::ostream& diag = options.cache ? static_cast<std::ostream&>(captured) : err;
+        try {
+            if (options.parsePool) {
+                ast = parseParallel(source.text(), ctx, *options.parsePool, diag);
+            } else {
+                Lexer lexer(source.text(), symbols);
+                Parser parser(lexer, ctx.arena, diag);
+                if (parsedFlat) flat = parser.parseFlat();
+                else ast = parser.parse();
+            }
+        } catch (...) {
+            err << captured.str();
+            throw;
+        }
+        err << captured.str();
+
+        if ((options.flatAst || options.cache) && !parsedFlat) flat = FlatAST::fromTree(ast);
 
         // Semantic phase
-        std::cout << "=== Semantic Analysis ===\n";
-        SemanticAnalyzer semantic;
+        out << "=== Semantic Analysis ===\n";
+        SemanticAnalyzer semantic(symbols);
         try {
-            semantic.analyze(ast);
-            std::cout << "OK\n\n";
+            if (options.flatAst) semantic.analyze(flat);
+            else semantic.analyze(ast);
         } catch (const std::exception& e) {
-            std::cerr << "[SEMANTIC ERROR] " << e.what() << "\n";
+            err << "[SEMANTIC ERROR] " << e.what() << "\n";
             return 1;
         }
+        // operators that always fail: the statements still fail when run,
+        // as they always did, unless --strict-types rejects the program
+        for (const std::string& error : semantic.typeErrors()) {
+            std::string message = (options.strictTypes ? "[SEMANTIC ERROR] " : "[SEMANTIC WARNING] ") + error + "\n";
+            err << message;
+            if (options.cache) captured << message;
+        }
+        if (options.strictTypes && !semantic.typeErrors().empty()) return 1;
+        out << "OK\n\n";
 
-        // IR generation
-        std::cout << "=== Generating IR ===\n";
-        IRGenerator irgen;
-        std::vector<IRInstruction> ir = irgen.generate(ast);
-
-        auto printIR = [](const IRInstruction& i) {
-            if (!i.arg2.empty())
-                std::cout << i.op << " " << i.arg1 << " " << i.arg2 << " -> " << i.result << "\n";
-            else if (!i.arg1.empty() && !i.result.empty())
-                std::cout << i.op << " " << i.arg1 << " -> " << i.result << "\n";
-            else if (!i.arg1.empty())
-                std::cout << i.op << " " << i.arg1 << "\n";
-            else
-                std::cout << i.op << "\n";
-        };
-
-        for (auto& i : ir) printIR(i);
-        std::cout << "\n";
-
-        // Optimize IR
-        std::cout << "=== Optimizing IR ===\n";
-        Optimizer opt;
-        std::vector<IRInstruction> optimizedIR = opt.optimize(ir);
-        for (auto& i : optimizedIR) printIR(i);
-        std::cout << "\n";
+        // IR generation, optimization and code generation
+        IRGenerator irgen(symbols);
+        IRProgram ir = options.flatAst ? irgen.generate(flat) : irgen.generate(ast);
+        Optimizer opt(options.optLevel);
+        IRProgram optimizedIR = opt.optimize(ir);
+        if (options.passStats) printPassStats(opt, err);
+        CodeGenerator codegen(options.registers);
+        auto asmCode = codegen.generateAssembly(optimizedIR, symbols);
+        if (options.allocStats) printAllocationStats(codegen.allocationStats(), err);
+        printCompileOutput(ir, optimizedIR, asmCode, symbols, out);
+        if (!options.native.empty()) buildNative(optimizedIR, symbols, options, err);
+        JitProgram jit;
+        if (options.jit) compileJit(jit, optimizedIR, symbols, options, err);
 
-        // Code generation
-        std::cout << "=== Code Generation ===\n";
-        CodeGenerator codegen;
-        auto asmCode = codegen.generateAssembly(optimizedIR);
-        for (auto &line : asmCode) std::cout << line << "\n";
-        std::cout << "\n";
+        if (options.cache) {
+            CacheEntry entry;
+            for (Symbol id = 0; id < symbols.size(); ++id) entry.names.push_back(symbols.name(id));
+            entry.ast = flat;
+            entry.ir = std::move(ir);
+            // --run-ir still needs it below
+            if (options.runIr) entry.optimizedIR = optimizedIR;
+            else entry.optimizedIR = std::move(optimizedIR);
+            entry.assembly = std::move(asmCode);
+            entry.diagnostics = captured.str();
+            options.cache->store(key, entry);
+        }
 
         // Run / Interpret
-        std::cout << "=== Running Program ===\n";
-        Interpreter interpreter;
-        interpreter.execute(ast);
+        out << "=== Running Program ===\n";
+        Interpreter interpreter(symbols);
+        if (jit.compiled()) jit.run();
+        else if (options.runIr) interpreter.execute(optimizedIR);
+        else if (options.flatAst) interpreter.execute(flat);
+        else interpreter.execute(ast);
 
     } catch (const std::exception& e) {
-        std::cerr << "Error while running " << filename << ": " << e.what() << std::endl;
+        err << "Error while running " << filename << ": " << e.what() << std::endl;
         return 1;
     }
 
     return 0;
 }
 
+// --watch: recompile `filename` whenever it changes, reusing every statement
+// the edit did not touch. Only the compile phases run; the program is not
+// executed. Polls the file's size and modification time until interrupted.
+static int watchFile(const std::string& filename, const DriverOptions& options) {
+    IncrementalCompiler compiler(options.optLevel, options.registers);
+    fs::file_time_type lastTime;
+    std::uintmax_t lastSize = 0;
+    bool first = true;
+
+    for (;;) {
+        std::error_code ec;
+        auto time = fs::last_write_time(filename, ec);
+        std::uintmax_t size = ec ? 0 : fs::file_size(filename, ec);
+
+        SourceFile source;
+        if (ec) {
+            if (first) {
+                std::cerr << "Cannot open file: " << filename << std::endl;
+                return 1;
+            }
+        } else if ((first || time != lastTime || size != lastSize) && source.open(filename)) {
+            lastTime = time;
+            lastSize = size;
+            UpdateStats stats = compiler.update(source.text());
+
+            std::cout << "[watch] " << filename << ": " << stats.statements << " statements, "
+                      << stats.rebuilt << " rebuilt, " << stats.rechecked << " rechecked, "
+                      << stats.reused << " reused in " << stats.milliseconds << " ms"
+                      << (stats.compacted ? " (compacted)" : "") << "\n";
+
+            // show only what changed; the first build would list everything
+            for (size_t index : stats.changed) {
+                const StatementUnit& unit = compiler.statement(index);
+                std::cerr << unit.diagnostics;
+                if (first) continue;
+                int line = unit.nodes.empty() ? compiler.line(index) : unit.nodes.front()->line;
+                std::cout << "line " << line << ":\n";
+                for (const auto& line : unit.assembly) std::cout << "    " << line << "\n";
+            }
+
+            std::string error = compiler.firstSemanticError();
+            if (!error.empty()) std::cerr << "[SEMANTIC ERROR] " << error << "\n";
+            std::cout << std::flush;
+            first = false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
+static void printUsage() {
+    std::cerr << "usage: compiler [-O0|-O1|-O2] [--pass-stats] [--registers N] [--alloc-stats] [--flat-ast]\n"
+                 "                [--native OUT [--runtime PATH]] [--jit] [--run-ir] [--strict-types] [--flush WHEN]\n"
+                 "                [--parse-threads N] [-j N] [--watch] [--cache DIR [--cache-size MB]] [input...]\n"
+                 "  an input is a source file, a directory (its .txt files) or @LIST (a file\n"
+                 "  naming one input per line); with none, every .txt file in tests/ is compiled.\n"
+                 "  More than one file is compiled as a batch, in parallel: each file's output\n"
+                 "  is written in input order, and its program reads FILE.in, if there is one\n"
+                 "  -O0, -O1, -O2      no optimization, statement-local passes, all passes (default)\n"
+                 "  --pass-stats       print runs, removed instructions and time of each optimizer pass\n"
+                 "  --registers N      allocate N registers in the generated code (default 8, at least 2);\n"
+                 "                     the JIT and native code use at most 6\n"
+                 "  --alloc-stats      print register pressure, spills and reloads of the generated code\n"
+                 "  --native OUT       also build an x86-64 executable OUT (with the system cc)\n"
+                 "  --runtime PATH     runtime source linked into it (default runtime/runtime.c)\n"
+                 "  --jit              run the optimized IR as machine code instead of interpreting the AST\n"
+                 "  --run-ir           interpret the optimized IR instead of the AST\n"
+                 "  --strict-types     reject a program with an operator that always fails, such as \"a\" * 2\n"
+                 "  --flush WHEN       write program output at exit, every line, or every N bytes\n"
+                 "                     (default: line on a terminal, else 65536)\n"
+                 "  --parse-threads N  parse top-level statements on N threads (0 = all cores);\n"
+                 "                     a batch then compiles one file at a time\n"
+                 "  -j N               compile a batch on N threads (default 0 = all cores)\n"
+                 "  --watch            recompile one file incrementally whenever it changes;\n"
+                 "                     of the options above, only -O and --registers apply\n"
+                 "  --cache DIR        reuse compilations of unchanged sources stored in DIR\n"
+                 "  --cache-size MB    size limit of the cache directory (default 256)\n";
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::string testFolder = "tests";
-        if (!fs::exists(testFolder)) {
-            std::cerr << "No tests folder found.\n";
+    DriverOptions options;
+    std::vector<std::string> inputs;
+    std::unique_ptr<ThreadPool> parsePool;
+    size_t jobs = 0;
+    bool watch = false;
+    std::string cacheDir;
+    uint64_t cacheMegabytes = 256;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--flat-ast") {
+            options.flatAst = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            options.optLevel = arg[2] - '0';
+        } else if (arg == "--pass-stats") {
+            options.passStats = true;
+        } else if (arg == "--registers" && i + 1 < argc) {
+            options.registers = std::atoi(argv[++i]);
+            if (options.registers < 2) {
+                std::cerr << "--registers needs at least 2\n";
+                return 1;
+            }
+        } else if (arg == "--alloc-stats") {
+            options.allocStats = true;
+        } else if (arg == "--native" && i + 1 < argc) {
+            options.native = argv[++i];
+        } else if (arg == "--runtime" && i + 1 < argc) {
+            options.runtime = argv[++i];
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--run-ir") {
+            options.runIr = true;
+        } else if (arg == "--strict-types") {
+            options.strictTypes = true;
+        } else if (arg == "--flush" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            long long bytes = std::strtoll(policy.c_str(), nullptr, 10);
+            if (policy == "exit") rt_set_flush(RT_FLUSH_EXIT, 0);
+            else if (policy == "line") rt_set_flush(RT_FLUSH_LINE, 0);
+            else if (bytes > 0) rt_set_flush(RT_FLUSH_SIZE, bytes);
+            else {
+                std::cerr << "--flush takes exit, line or a size in bytes\n";
+                return 1;
+            }
+        } else if (arg == "--parse-threads" && i + 1 < argc) {
+            parsePool = std::make_unique<ThreadPool>(std::strtoul(argv[++i], nullptr, 10));
+            options.parsePool = parsePool.get();
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2 && std::isdigit(static_cast<unsigned char>(arg[2]))) {
+            jobs = std::strtoul(arg.c_str() + 2, nullptr, 10);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            cacheMegabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg.rfind("-", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage();
             return 1;
+        } else {
+            inputs.push_back(arg);
         }
+    }
 
-        for (auto& entry : fs::directory_iterator(testFolder)) {
-            if (entry.path().extension() == ".txt") {
-                std::cout << "\n=== Running " << entry.path().string() << " ===\n";
-                runCompilerOnFile(entry.path().string());
-                std::cout << "-------------------------------------\n";
+    if (watch) {
+        if (inputs.size() != 1) {
+            std::cerr << "--watch takes exactly one file\n";
+            printUsage();
+            return 1;
+        }
+        // it compiles statement by statement and runs nothing: only -O and
+        // --registers apply. Types are inferred per statement too, so the
+        // type errors --strict-types rejects, which follow variables from
+        // statement to statement, are never found.
+        const std::pair<bool, const char*> unsupported[] = {
+            {options.strictTypes, "--strict-types"},
+            {options.flatAst, "--flat-ast"},
+            {options.parsePool != nullptr, "--parse-threads"},
+            {jobs != 0, "-j"},
+            {!cacheDir.empty(), "--cache"},
+            {options.passStats, "--pass-stats"},
+            {options.allocStats, "--alloc-stats"},
+            {!options.native.empty(), "--native"},
+            {options.runtime != DriverOptions().runtime, "--runtime"},
+            {options.jit, "--jit"},
+            {options.runIr, "--run-ir"},
+        };
+        for (const auto& [set, name] : unsupported) {
+            if (set) {
+                std::cerr << "--watch does not support " << name << "\n";
+                printUsage();
+                return 1;
             }
         }
-    } else {
-        runCompilerOnFile(argv[1]);
+        return watchFile(inputs[0], options);
     }
 
-    return 0;
+    if (inputs.empty()) {
+        if (!fs::exists("tests")) {
+            std::cerr << "No tests folder found.\n";
+            return 1;
+        }
+        inputs.push_back("tests");
+    }
+    std::vector<std::string> files;
+    if (!collectSources(inputs, files)) return 1;
+    // a single file named on the command line runs on its own, reading
+    // standard input
+    bool batch = inputs.size() != 1 || files.size() != 1 || files[0] != inputs[0];
+
+    if (!options.native.empty() && batch) {
+        std::cerr << "--native takes exactly one file\n";
+        printUsage();
+        return 1;
+    }
+
+    std::unique_ptr<CompileCache> cache;
+    if (!cacheDir.empty()) {
+        cache = std::make_unique<CompileCache>(cacheDir, cacheMegabytes << 20);
+        options.cache = cache.get();
+    }
+
+    int status = 0;
+    if (!batch) {
+        status = runCompilerOnFile(files[0], options);
+    } else {
+        // the parse pool runs one loop at a time, so it serves one file at a time
+        ThreadPool pool(parsePool ? 1 : jobs);
+        auto compile = [&](const std::string& file, std::ostream& out, std::ostream& err) {
+            out << "\n=== Running " << file << " ===\n";
+            int result = runCompilerOnFile(file, options, out, err);
+            out << "-------------------------------------\n";
+            return result;
+        };
+        BatchSummary summary = compileBatch(files, pool, compile);
+        std::cerr << "[batch] " << summary.files << " files on " << pool.size()
+                  << (pool.size() == 1 ? " thread in " : " threads in ") << summary.milliseconds << " ms, "
+                  << summary.failed.size() << " failed\n";
+        for (const auto& file : summary.failed) std::cerr << "[batch] failed: " << file << "\n";
+        status = summary.failed.empty() ? 0 : 1;
+    }
+    if (cache) {
+        const CompileCache::Stats& stats = cache->stats();
+        std::cerr << "[cache] " << stats.hits << " hits, " << stats.misses << " misses, " << stats.stores
+                  << " stored, " << stats.evictions << " evicted\n";
+    }
+    return status;
 }
@@ -0,0 +1,212 @@
+#include "parallel.h"
+#include "scan.h"
+#include <exception>
+#include <memory>
+#include <sstream>
+
+// Skip whitespace and comments from `p`; nullptr if a comment is never
+// closed.
+static const char* skipBlank(const char* p, const char* end) {
+    for (;;) {
+        int lines = 0;
+        p = scan::skipSpace(p, end, lines);
+        if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+            p = scan::findByte(p + 2, end, '\n');
+        } else if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+            const char* close = scan::findCommentClose(p + 2, end);
+            if (close == end) return nullptr;
+            p = close + 2;
+        } else {
+            return p;
+        }
+    }
+}
+
+// True if the Lexer can read the first token at `p` without an error. A
+// sequential parse fetches that token while eating the previous statement's
+// ';', and a lexer error there discards the previous statement, so chunks
+// must only be cut where that cannot happen.
+static bool cleanTokenStart(const char* p, const char* end) {
+    p = skipBlank(p, end);
+    if (!p) return false;
+    if (p == end) return true;
+    char c = *p;
+    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') return true;
+    if (c == '"') return scan::findByte(p + 1, end, '"') != end;
+    switch (c) {
+        case '+': case '-': case '*': case '/': case '=': case '(': case ')': case ';':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Advance `p` (which is always outside strings and comments) to the first
+// clean statement boundary at or after `target` and return it, or return
+// nullptr if there is none before `end`.
+static const char* nextCut(const char*& p, const char* target, const char* end) {
+    // Strings and comments are the only places a ';' is not a statement
+    // end, so hop from one '"' or '/' to the next; once the next one lies
+    // past the target, the first ';' in between is a boundary.
+    while (p < end) {
+        const char* special = scan::findEither(p, end, '"', '/');
+        if (special > target || special == end) {
+            const char* semi = scan::findByte(p < target ? target : p, special, ';');
+            if (semi != special) {
+                p = semi + 1;
+                if (cleanTokenStart(p, end)) return p;
+                continue;
+            }
+        }
+        if (special == end) {
+            p = end;
+            break;
+        }
+        if (*special == '"') {
+            const char* close = scan::findByte(special + 1, end, '"');
+            p = close == end ? end : close + 1;
+        } else if (special + 1 < end && special[1] == '/') {
+            p = scan::findByte(special + 2, end, '\n');
+        } else if (special + 1 < end && special[1] == '*') {
+            const char* close = scan::findCommentClose(special + 2, end);
+            p = close == end ? end : close + 2;
+        } else {
+            p = special + 1; // division operator
+        }
+    }
+    return nullptr;
+}
+
+std::vector<SourceChunk> splitStatements(std::string_view text, size_t chunks) {
+    std::vector<SourceChunk> out;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if (chunks == 0) chunks = 1;
+
+    const char* chunkStart = begin;
+    int line = 1;
+    const char* p = begin;
+
+    for (size_t k = 1; k < chunks && p < end; ++k) {
+        const char* target = begin + text.size() * k / chunks;
+        if (target < p) continue;
+
+        const char* cut = nextCut(p, target, end);
+        if (!cut) break;
+
+        out.push_back({static_cast<size_t>(chunkStart - begin), static_cast<size_t>(cut - begin), line});
+        line += scan::countNewlines(chunkStart, cut);
+        chunkStart = cut;
+    }
+
+    out.push_back({static_cast<size_t>(chunkStart - begin), text.size(), line});
+    return out;
+}
+
+std::vector<SourceChunk> statementRanges(std::string_view text) {
+    std::vector<SourceChunk> out;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    const char* start = begin;
+    int line = 1;
+    const char* p = begin;
+    while (const char* cut = nextCut(p, p, end)) {
+        out.push_back({static_cast<size_t>(start - begin), static_cast<size_t>(cut - begin), line});
+        line += scan::countNewlines(start, cut);
+        start = cut;
+    }
+    // whitespace and comments after the last statement are no statement
+    if (start < end && skipBlank(start, end) != end)
+        out.push_back({static_cast<size_t>(start - begin), text.size(), line});
+    return out;
+}
+
+namespace {
+
+// Everything one worker produces for its chunk
+struct ChunkResult {
+    SymbolTable symbols;
+    Arena arena;
+    std::vector<ASTNode*> nodes;
+    std::ostringstream diag;
+    std::exception_ptr error; // lexer failure that aborted the chunk
+};
+
+// Rewrite the chunk-local symbols in a statement to ids of the shared table
+void remapSymbols(ASTNode* root, const std::vector<Symbol>& remap, std::vector<ASTNode*>& work) {
+    work.clear();
+    work.push_back(root);
+    while (!work.empty()) {
+        ASTNode* node = work.back();
+        work.pop_back();
+        switch (node->kind) {
+            case NodeKind::String:
+            case NodeKind::Variable:
+            case NodeKind::Assign:
+            case NodeKind::Cin:
+                node->symbol = remap[node->symbol];
+                break;
+            default:
+                break;
+        }
+        if (node->right) work.push_back(node->right);
+        if (node->left) work.push_back(node->left);
+    }
+}
+
+}
+
+std::vector<ASTNode*> parseParallel(std::string_view text, CompileContext& ctx, ThreadPool& pool,
+                                    std::ostream& diag, size_t minChunkBytes) {
+    size_t wanted = pool.size() * 4; // a few chunks per thread to even out the load
+    if (minChunkBytes > 0 && text.size() / minChunkBytes < wanted) wanted = text.size() / minChunkBytes;
+    std::vector<SourceChunk> chunks = splitStatements(text, wanted);
+
+    std::vector<std::unique_ptr<ChunkResult>> results(chunks.size());
+    pool.parallelFor(chunks.size(), [&](size_t i) {
+        results[i] = std::make_unique<ChunkResult>();
+        ChunkResult& r = *results[i];
+        const SourceChunk& c = chunks[i];
+        try {
+            Lexer lexer(text.substr(c.begin, c.end - c.begin), r.symbols, c.firstLine);
+            Parser parser(lexer, r.arena, r.diag);
+            r.nodes = parser.parse();
+        } catch (...) {
+            r.error = std::current_exception();
+        }
+    });
+
+    // Intern every chunk's symbols into the shared table in source order,
+    // then rewrite the ASTs in parallel (they only read the remap tables).
+    // Chunks after the first failed one are dropped, as a sequential parse
+    // would never have reached them.
+    size_t used = 0;
+    std::vector<std::vector<Symbol>> remaps(chunks.size());
+    size_t total = 0;
+    while (used < chunks.size()) {
+        ChunkResult& r = *results[used];
+        remaps[used].resize(r.symbols.size());
+        for (Symbol s = 0; s < r.symbols.size(); ++s) remaps[used][s] = ctx.symbols.intern(r.symbols.name(s));
+        total += r.nodes.size();
+        used++;
+        if (r.error) break;
+    }
+
+    pool.parallelFor(used, [&](size_t i) {
+        std::vector<ASTNode*> work;
+        for (ASTNode* node : results[i]->nodes) remapSymbols(node, remaps[i], work);
+    });
+
+    std::vector<ASTNode*> nodes;
+    nodes.reserve(total);
+    for (size_t i = 0; i < used; ++i) {
+        ChunkResult& r = *results[i];
+        diag << r.diag.str();
+        // a sequential parse stops at the first lexer error
+        if (r.error) std::rethrow_exception(r.error);
+        nodes.insert(nodes.end(), r.nodes.begin(), r.nodes.end());
+        ctx.arena.adopt(r.arena);
+    }
+    return nodes;
+}
@@ -1,9 +1,26 @@
 #include "parser.h"
+#include "flatast.h"
+#include <charconv>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+
+const char* nodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::Number: return "number";
+        case NodeKind::String: return "string";
+        case NodeKind::Variable: return "variable";
+        case NodeKind::BinOp: return "binop";
+        case NodeKind::Assign: return "assign";
+        case NodeKind::Cin: return "cin";
+        case NodeKind::Cout: return "cout";
+    }
+    return "?";
+}
 
 // Constructor
-Parser::Parser(Lexer lexer) : lexer(lexer), currentToken(this->lexer.getNextToken()) {}
+Parser::Parser(Lexer lexer, Arena& arena, std::ostream& diag)
+    : lexer(lexer), arena(arena), diag(diag), currentToken(this->lexer.getNextToken()) {}
 
 // Consume current token if it matches type
 // eat() enforces grammar rules by validating a token
@@ -11,94 +28,189 @@ void Parser::eat(TokenType type) {
     if (currentToken.type == type)
         currentToken = lexer.getNextToken();
     else
-        throw std::runtime_error("Unexpected token: " + currentToken.value +
+        throw std::runtime_error("Unexpected token: " + std::string(currentToken.value) +
                                  " at line " + std::to_string(currentToken.line));
 }
 
-// Parse numbers, strings, variables, parentheses, unary minus
-ASTNode* Parser::factor() {
+namespace {
+
+// Output of the grammar as pointer nodes in the arena
+struct TreeBuilder {
+    using Node = ASTNode*;
+    Arena& arena;
+
+    Node number(long long value, int line) {
+        Node node = arena.make<ASTNode>(NodeKind::Number, line);
+        node->number = value;
+        return node;
+    }
+    Node named(NodeKind kind, Symbol symbol, int line, Node value = nullptr) {
+        Node node = arena.make<ASTNode>(kind, line, value);
+        node->symbol = symbol;
+        return node;
+    }
+    Node binary(char op, Node left, Node right, int line) {
+        Node node = arena.make<ASTNode>(NodeKind::BinOp, line, left, right);
+        node->op = op;
+        return node;
+    }
+    Node cout(Node value, int line) { return arena.make<ASTNode>(NodeKind::Cout, line, value); }
+};
+
+// Output of the grammar as FlatAST entries. The grammar makes every node
+// after its children, left before right, which is the flat layout's
+// post-order.
+struct FlatBuilder {
+    using Node = NodeIndex;
+    FlatAST& ast;
+
+    Node number(long long value, int line) { return ast.add(NodeKind::Number, value, line); }
+    Node named(NodeKind kind, Symbol symbol, int line, Node value = NO_NODE) {
+        return ast.add(kind, symbol, line, value);
+    }
+    Node binary(char op, Node left, Node right, int line) { return ast.add(NodeKind::BinOp, op, line, left, right); }
+    Node cout(Node value, int line) { return ast.add(NodeKind::Cout, 0, line, value); }
+};
+
+}
+
+// Parse numbers, strings and variables
+template <class B>
+typename B::Node Parser::operand(B& build) {
     Token token = currentToken;
 
     if (token.type == NUMBER) {
         eat(NUMBER);
-        return new ASTNode("number", "", token.value, "", nullptr, nullptr, token.line);
+        long long value = 0;
+        const char* first = token.value.data();
+        const char* last = first + token.value.size();
+        if (std::from_chars(first, last, value).ec != std::errc())
+            throw std::runtime_error("Integer literal out of range: " + std::string(token.value) +
+                                     " at line " + std::to_string(token.line));
+        return build.number(value, token.line);
     }
     if (token.type == STRING) {
         eat(STRING);
-        return new ASTNode("string", "", token.value, "", nullptr, nullptr, token.line);
+        return build.named(NodeKind::String, token.symbol, token.line);
     }
     if (token.type == IDENTIFIER) {
         eat(IDENTIFIER);
-        return new ASTNode("variable", token.value, "", "", nullptr, nullptr, token.line);
-    }
-    if (token.type == LPAREN) {
-        eat(LPAREN);
-        ASTNode* node = expr();
-        eat(RPAREN);
-        return node;
-    }
-    if (token.type == MINUS) {  // unary minus
-        eat(MINUS);
-        ASTNode* node = factor();
-        // create a binary subtraction from 0 - node
-        ASTNode* zero = new ASTNode("number", "", "0", "", nullptr, nullptr, token.line);
-        return new ASTNode("binop", "", "", "-", zero, node, token.line);
+        return build.named(NodeKind::Variable, token.symbol, token.line);
     }
 
-    throw std::runtime_error("Invalid factor: " + token.value + " at line " + std::to_string(token.line));
+    throw std::runtime_error("Invalid factor: " + std::string(token.value) + " at line " + std::to_string(token.line));
 }
 
-// Parse *, /
-ASTNode* Parser::term() {
-    ASTNode* node = factor();
-
-    while (currentToken.type == STAR || currentToken.type == SLASH) {
-        Token op = currentToken;
-        eat(op.type);
-        ASTNode* rightNode = factor();
-        node = new ASTNode("binop", "", "", op.value, node, rightNode, op.line);
+// binding strength of an infix operator token, 0 if it is not one
+static int precedence(TokenType type) {
+    switch (type) {
+        case PLUS:
+        case MINUS: return 1;
+        case STAR:
+        case SLASH: return 2;
+        default: return 0;
     }
-
-    return node;
 }
 
-// Parse +, -
-ASTNode* Parser::expr() {
-    ASTNode* node = term();
+// Parse an expression with +, - (lowest), *, / (left associative), unary
+// minus and parentheses. This is precedence climbing over two explicit
+// stacks instead of one native call per nesting level, so deeply nested or
+// very long expressions use heap memory, not native stack.
+//
+// It builds the same tree the grammar
+//   expr   := term (('+' | '-') term)*
+//   term   := factor (('*' | '/') factor)*
+//   factor := NUMBER | STRING | IDENTIFIER | '(' expr ')' | '-' factor
+// describes, with unary minus still lowered to (0 - factor).
+template <class B>
+typename B::Node Parser::expr(B& build) {
+    using Node = typename B::Node;
+    struct Pending {
+        char op;  // '+', '-', '*', '/'; 'u' unary minus; '(' open paren
+        int line;
+        Node zero; // 'u': the 0 it subtracts from, made before the factor
+    };
+    std::vector<Node> operands;
+    std::vector<Pending> ops;
+    int openParens = 0;
 
-    while (currentToken.type == PLUS || currentToken.type == MINUS) {
-        Token op = currentToken;
-        eat(op.type);
-        ASTNode* rightNode = term();
-        node = new ASTNode("binop", "", "", op.value, node, rightNode, op.line);
-    }
+    auto reduceBinary = [&]() {
+        Pending p = ops.back();
+        ops.pop_back();
+        Node right = operands.back();
+        operands.pop_back();
+        operands.back() = build.binary(p.op, operands.back(), right, p.line);
+    };
+    // a finished factor absorbs the unary minuses written directly before it
+    auto applyUnary = [&]() {
+        while (!ops.empty() && ops.back().op == 'u') {
+            Pending p = ops.back();
+            ops.pop_back();
+            operands.back() = build.binary('-', p.zero, operands.back(), p.line);
+        }
+    };
+    auto isBinary = [](char op) { return op != 'u' && op != '('; };
+    auto strength = [](char op) { return (op == '*' || op == '/') ? 2 : 1; };
 
-    return node;
-}
+    for (;;) {
+        // prefix position: unary minuses and open parens, then an operand
+        while (currentToken.type == MINUS || currentToken.type == LPAREN) {
+            if (currentToken.type == MINUS) {
+                ops.push_back({'u', currentToken.line, build.number(0, currentToken.line)});
+                eat(MINUS);
+            } else {
+                ops.push_back({'(', currentToken.line, Node()});
+                eat(LPAREN);
+                openParens++;
+            }
+        }
+        operands.push_back(operand(build));
+        applyUnary();
 
-// Parse variable assignment
-ASTNode* Parser::assignment() {
-    if (currentToken.type == IDENTIFIER) {
-        std::string varName = currentToken.value;
-        int lineNum = currentToken.line;  // capture line of variable
-        eat(IDENTIFIER);
+        // infix position: close parens, then an operator or the end
+        while (currentToken.type == RPAREN && openParens > 0) {
+            while (ops.back().op != '(') reduceBinary();
+            ops.pop_back();
+            eat(RPAREN);
+            openParens--;
+            applyUnary();
+        }
 
-        if (currentToken.type == ASSIGN) {
-            eat(ASSIGN);
-            ASTNode* valueNode = expr();
-            eat(SEMICOLON);
-            return new ASTNode("assign", varName, "", "", valueNode, nullptr, lineNum);
-        } else {
-            // not an assignment; rollback not implemented, so treat as error
-            throw std::runtime_error("Expected '=' after identifier at line " + std::to_string(lineNum));
+        int prec = precedence(currentToken.type);
+        if (prec == 0) {
+            // inside parentheses only ')' may follow; eat reports the error
+            if (openParens > 0) eat(RPAREN);
+            break;
         }
+        while (!ops.empty() && isBinary(ops.back().op) && strength(ops.back().op) >= prec) reduceBinary();
+        ops.push_back({currentToken.value[0], currentToken.line, Node()});
+        eat(currentToken.type);
     }
 
-    return nullptr;
+    while (!ops.empty()) reduceBinary();
+    return operands.back();
+}
+
+// Parse variable assignment; the current token is its identifier
+template <class B>
+typename B::Node Parser::assignment(B& build) {
+    Symbol varName = currentToken.symbol;
+    int lineNum = currentToken.line;  // capture line of variable
+    eat(IDENTIFIER);
+
+    if (currentToken.type != ASSIGN) {
+        // not an assignment; rollback not implemented, so treat as error
+        throw std::runtime_error("Expected '=' after identifier at line " + std::to_string(lineNum));
+    }
+    eat(ASSIGN);
+    auto valueNode = expr(build);
+    eat(SEMICOLON);
+    return build.named(NodeKind::Assign, varName, lineNum, valueNode);
 }
 
 // Parse statements: assignment, cin, cout
-ASTNode* Parser::statement() {
+template <class B>
+typename B::Node Parser::statement(B& build) {
     if (currentToken.type == CIN) {
         int lineNum = currentToken.line;
         eat(CIN);
@@ -107,44 +219,62 @@ ASTNode* Parser::statement() {
         if (currentToken.type != IDENTIFIER)
             throw std::runtime_error("Expected variable name in cin at line " + std::to_string(currentToken.line));
 
-        std::string varName = currentToken.value;
+        Symbol varName = currentToken.symbol;
         eat(IDENTIFIER);
         eat(RPAREN);
         eat(SEMICOLON);
-        return new ASTNode("cin", varName, "", "", nullptr, nullptr, lineNum);
+        return build.named(NodeKind::Cin, varName, lineNum);
     }
 
     if (currentToken.type == COUT) {
         int lineNum = currentToken.line;
         eat(COUT);
         eat(LPAREN);
-        ASTNode* exprNode = expr();
+        auto exprNode = expr(build);
         eat(RPAREN);
         eat(SEMICOLON);
-        return new ASTNode("cout", "", "", "", exprNode, nullptr, lineNum);
+        return build.cout(exprNode, lineNum);
     }
 
-    ASTNode* assignNode = nullptr;
-    // Try to parse assignment; if it throws, let parse() catch and recover
-    assignNode = assignment();
-    if (assignNode != nullptr) return assignNode;
+    // an assignment throws if it is not one; parse() recovers
+    if (currentToken.type == IDENTIFIER) return assignment(build);
 
     throw std::runtime_error("Unknown statement at line " + std::to_string(currentToken.line));
 }
 
+// Report a statement that failed to parse and skip to the next semicolon
+void Parser::recover(const std::exception& error) {
+    diag << error.what() << std::endl;
+    while (currentToken.type != SEMICOLON && currentToken.type != END)
+        currentToken = lexer.getNextToken();
+    if (currentToken.type == SEMICOLON) currentToken = lexer.getNextToken();
+}
+
 // Parse all statements in input
 std::vector<ASTNode*> Parser::parse() {
+    TreeBuilder build{arena};
     std::vector<ASTNode*> nodes;
     while (currentToken.type != END) {
         try {
-            nodes.push_back(statement());
+            nodes.push_back(statement(build));
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-            // Skip to next semicolon to continue parsing
-            while (currentToken.type != SEMICOLON && currentToken.type != END)
-                currentToken = lexer.getNextToken();
-            if (currentToken.type == SEMICOLON) currentToken = lexer.getNextToken();
+            recover(e);
         }
     }
     return nodes;
 }
+
+FlatAST Parser::parseFlat() {
+    FlatAST ast;
+    FlatBuilder build{ast};
+    while (currentToken.type != END) {
+        size_t begin = ast.size();
+        try {
+            ast.statements.push_back(statement(build));
+        } catch (const std::exception& e) {
+            ast.truncate(begin); // what the statement had made so far
+            recover(e);
+        }
+    }
+    return ast;
+}
@@ -0,0 +1,235 @@
+#include "passes.h"
+#include "ssa.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+DefUse::DefUse(IRProgram& ir) : ir(ir) {
+    build();
+}
+
+void DefUse::build() {
+    defs.assign(ir.temps + 1, NO_SLOT);
+    first.assign(ir.temps + 1, NO_SLOT);
+    count.assign(ir.temps + 1, 0);
+    next.assign(ir.code.size() * 2, NO_SLOT);
+    prev.assign(ir.code.size() * 2, NO_SLOT);
+    nops = 0;
+    for (uint32_t i = 0; i < ir.code.size(); ++i) {
+        const IRInstruction& ins = ir.code[i];
+        if (ins.op == IROp::Nop) ++nops;
+        for (int k = 0; k < 2; ++k) {
+            if (ins.kinds[k] == OperandKind::Temp) link(i * 2 + k);
+        }
+        if (ins.kinds[2] == OperandKind::Temp) defs[ins.ids[2]] = i;
+    }
+}
+
+void DefUse::link(uint32_t slot) {
+    uint32_t temp = ir.code[slot / 2].ids[slot % 2];
+    next[slot] = first[temp];
+    prev[slot] = NO_SLOT;
+    if (first[temp] != NO_SLOT) prev[first[temp]] = slot;
+    first[temp] = slot;
+    ++count[temp];
+}
+
+void DefUse::unlink(uint32_t slot) {
+    uint32_t temp = ir.code[slot / 2].ids[slot % 2];
+    if (prev[slot] != NO_SLOT) next[prev[slot]] = next[slot];
+    else first[temp] = next[slot];
+    if (next[slot] != NO_SLOT) prev[next[slot]] = prev[slot];
+    --count[temp];
+}
+
+void DefUse::setArgument(uint32_t i, int k, Operand o) {
+    IRInstruction& ins = ir.code[i];
+    if (ins.kinds[k] == OperandKind::Temp) unlink(i * 2 + k);
+    ins.kinds[k] = o.kind;
+    ins.ids[k] = o.id;
+    if (o.kind == OperandKind::Temp) link(i * 2 + k);
+}
+
+void DefUse::replaceUses(uint32_t temp, Operand with) {
+    if (with == Operand::temp(temp)) return;
+    forEachUse(temp, [&](uint32_t i, int k) { setArgument(i, k, with); });
+}
+
+void DefUse::rewrite(uint32_t i, const IRInstruction& ins) {
+    for (int k = 0; k < 2; ++k) setArgument(i, k, {ins.kinds[k], ins.ids[k]});
+    ir.code[i].op = ins.op;
+}
+
+void DefUse::remove(uint32_t i) {
+    IRInstruction& ins = ir.code[i];
+    if (ins.op == IROp::Nop) return;
+    setArgument(i, 0, Operand());
+    setArgument(i, 1, Operand());
+    if (ins.kinds[2] == OperandKind::Temp && defs[ins.ids[2]] == i) defs[ins.ids[2]] = NO_SLOT;
+    ins = IRInstruction(IROp::Nop, Operand());
+    ++nops;
+}
+
+void DefUse::compact() {
+    if (nops == 0) return;
+    // kept[i] = instructions kept before i
+    std::vector<uint32_t> kept(ir.code.size() + 1);
+    size_t n = 0;
+    for (size_t i = 0; i < ir.code.size(); ++i) {
+        kept[i] = static_cast<uint32_t>(n);
+        if (ir.code[i].op != IROp::Nop) {
+            if (i < ir.lines.size()) ir.lines[n] = ir.lines[i];
+            ir.code[n++] = ir.code[i];
+        }
+    }
+    kept[ir.code.size()] = static_cast<uint32_t>(n);
+    ir.code.resize(n);
+    if (ir.lines.size() > n) ir.lines.resize(n);
+    for (IRNote& note : ir.notes) note.before = kept[note.before];
+    build();
+}
+
+void PassManager::add(std::unique_ptr<Pass> pass) {
+    PassStats s;
+    s.name = pass->name();
+    stats.push_back(s);
+    passes.push_back(std::move(pass));
+}
+
+void PassManager::run(IRProgram& ir, OptimizationReport& report) {
+    DefUse du(ir);
+    // changes counts the runs that changed something; a pass whose last
+    // run saw the program as it is now would find nothing new
+    size_t changes = 0;
+    std::vector<size_t> seen(passes.size(), SIZE_MAX);
+    lastRounds = 0;
+    for (bool changed = true; changed && lastRounds < maxRounds;) {
+        changed = false;
+        bool ran = false;
+        for (size_t p = 0; p < passes.size(); ++p) {
+            if (seen[p] == changes) continue;
+            ran = true;
+            size_t before = du.liveInstructions();
+            auto start = std::chrono::steady_clock::now();
+            bool c = passes[p]->run(du, report);
+            auto end = std::chrono::steady_clock::now();
+
+            PassStats& s = stats[p];
+            ++s.runs;
+            s.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+            s.removed += before - du.liveInstructions();
+            if (c) {
+                ++s.changes;
+                ++changes;
+                changed = true;
+            }
+            seen[p] = changes;
+        }
+        if (ran) ++lastRounds;
+    }
+    du.compact();
+}
+
+// Remove the instructions in `work` and, recursively, the definitions of
+// their operands, as long as the result is unused and cannot fault.
+// Returns the number of instructions removed.
+static size_t removeUnused(DefUse& du, const SSAInfo& ssa, std::vector<uint32_t> work) {
+    auto removable = [&](uint32_t i) {
+        const IRInstruction& ins = du.at(i);
+        bool sideEffect = ins.op == IROp::Print || ins.op == IROp::Store || ins.op == IROp::Read;
+        return ins.op != IROp::Nop && !sideEffect && !ssa.canFault[i] && ins.kinds[2] == OperandKind::Temp &&
+               du.uses(ins.ids[2]) == 0;
+    };
+
+    size_t removed = 0;
+    while (!work.empty()) {
+        uint32_t i = work.back();
+        work.pop_back();
+        if (!removable(i)) continue;
+        IRInstruction ins = du.at(i);
+        du.remove(i);
+        ++removed;
+        // operands that lost their last reader may be dead now
+        for (int k = 0; k < 2; ++k) {
+            if (ins.kinds[k] != OperandKind::Temp || du.uses(ins.ids[k]) != 0) continue;
+            uint32_t def = du.definition(ins.ids[k]);
+            if (def != DefUse::NO_SLOT) work.push_back(def);
+        }
+    }
+    return removed;
+}
+
+bool DeadCodePass::run(DefUse& du, OptimizationReport& report) {
+    SSAInfo ssa = SSAInfo::build(du.program());
+    std::vector<uint32_t> work;
+    for (uint32_t i = 0; i < du.size(); ++i) {
+        const IRInstruction& ins = du.at(i);
+        if (ins.kinds[2] == OperandKind::Temp && du.uses(ins.ids[2]) == 0) work.push_back(i);
+    }
+    bool changed = removeUnused(du, ssa, std::move(work)) > 0;
+    if (changed) report.deadCode = true;
+    return changed;
+}
+
+bool DeadStorePass::run(DefUse& du, OptimizationReport& report) {
+    const IRProgram& ir = du.program();
+    SSAInfo ssa = SSAInfo::build(ir);
+
+    // a STORE certainly happens unless an earlier part of its statement
+    // can fault; only then does it hide the previous value
+    std::vector<bool> certain(ir.code.size());
+    bool safe = true;
+    Symbol vars = 0;
+    for (uint32_t i = 0; i < ir.code.size(); ++i) {
+        const IRInstruction& ins = ir.code[i];
+        certain[i] = safe;
+        safe = safe && !ssa.canFault[i];
+        if (endsStatement(ins.op)) safe = true;
+        for (int k = 0; k < 3; ++k) {
+            if (ins.kinds[k] == OperandKind::Var) vars = std::max(vars, ins.ids[k] + 1);
+        }
+    }
+
+    // backwards: nothing is live when the program ends
+    std::vector<bool> live(vars, false);
+    size_t stores = 0, feeding = 0;
+    for (uint32_t i = static_cast<uint32_t>(ir.code.size()); i-- > 0;) {
+        const IRInstruction& ins = ir.code[i];
+        switch (ins.op) {
+            case IROp::Load:
+                live[ins.ids[0]] = true;
+                break;
+            case IROp::Print:
+                if (ins.kinds[0] == OperandKind::Var) live[ins.ids[0]] = true;
+                break;
+            case IROp::Read:
+                live[ins.ids[2]] = false; // the input is still consumed
+                break;
+            case IROp::Store: {
+                Symbol var = ins.ids[2];
+                if (live[var]) {
+                    if (certain[i]) live[var] = false;
+                    break;
+                }
+                // a dead store after something that can fault stays: it
+                // ends the statement the runtime error abandons
+                if (!certain[i]) break;
+                // drop it and the computation feeding it, which lies
+                // earlier and has not been visited yet
+                Operand value = ins.arg1();
+                du.remove(i);
+                ++stores;
+                if (value.kind == OperandKind::Temp && du.uses(value.id) == 0 &&
+                    du.definition(value.id) != DefUse::NO_SLOT) {
+                    feeding += removeUnused(du, ssa, {du.definition(value.id)});
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    report.deadStores += stores;
+    report.deadStoreCode += feeding;
+    return stores > 0;
+}
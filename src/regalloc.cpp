@@ -0,0 +1,169 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace {
+
+bool isLiteral(Operand o) {
+    return o.kind == OperandKind::Int || o.kind == OperandKind::Str;
+}
+
+// Whether argument `k` of `ins` is read from a register. MOV and PRINT
+// take literals as they are; LOAD reads a variable.
+bool readsRegister(const IRInstruction& ins, int k) {
+    Operand o = k == 0 ? ins.arg1() : ins.arg2();
+    switch (ins.op) {
+        case IROp::Mov:
+            return o.kind == OperandKind::Temp;
+        case IROp::Print:
+            return o.kind == OperandKind::Temp || o.kind == OperandKind::Var;
+        case IROp::Store:
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul:
+        case IROp::Div:
+        case IROp::IAdd:
+        case IROp::ISub:
+        case IROp::IMul:
+        case IROp::IDiv:
+        case IROp::Concat:
+            return o.kind == OperandKind::Temp || isLiteral(o);
+        default:
+            return false;
+    }
+}
+
+}
+
+RegisterAllocation RegisterAllocation::build(const IRProgram& ir, int registers, int scratch) {
+    RegisterAllocation ra;
+    size_t n = ir.code.size();
+    ra.operand.assign(n * 2, NONE);
+    ra.result.assign(n, NONE);
+    std::vector<uint32_t> tempInterval(ir.temps + 1, NONE);
+    std::vector<uint32_t> hint; // per interval: interval whose register it would like
+
+    // liveness: the IR has no branches, so a temp is live from its
+    // definition to its last read, and intervals come out sorted by start
+    auto add = [&](uint32_t position, bool literal) {
+        LiveInterval iv;
+        iv.start = iv.end = position;
+        iv.literal = literal;
+        ra.intervals.push_back(iv);
+        hint.push_back(NONE);
+        return static_cast<uint32_t>(ra.intervals.size() - 1);
+    };
+    for (uint32_t i = 0; i < n; ++i) {
+        const IRInstruction& ins = ir.code[i];
+        for (int k = 0; k < 2; ++k) {
+            if (!readsRegister(ins, k)) continue;
+            uint32_t& iv = ra.operand[i * 2 + k];
+            if (ins.kinds[k] == OperandKind::Temp && tempInterval[ins.ids[k]] != NONE) {
+                iv = tempInterval[ins.ids[k]];
+                ra.intervals[iv].end = 2 * i;
+            } else {
+                iv = add(2 * i, true);
+            }
+        }
+        if (ins.kinds[2] == OperandKind::Temp || ins.op == IROp::Read) {
+            // READ goes through a register on its way to the variable
+            uint32_t iv = add(2 * i + 1, ins.op == IROp::Read);
+            ra.result[i] = iv;
+            if (ins.kinds[2] == OperandKind::Temp) tempInterval[ins.ids[2]] = iv;
+            hint[iv] = ra.operand[i * 2];
+        }
+    }
+
+    AllocationStats& st = ra.stats;
+    st.registers = registers;
+    st.intervals = ra.intervals.size();
+
+    // register pressure: intervals alive at each position
+    std::vector<int> delta(2 * n + 2, 0);
+    for (const LiveInterval& iv : ra.intervals) {
+        ++delta[iv.start];
+        --delta[iv.end + 1];
+    }
+    long alive = 0;
+    for (int d : delta) {
+        alive += d;
+        st.maxPressure = std::max(st.maxPressure, static_cast<size_t>(alive));
+    }
+
+    // linear scan over `usable` registers; returns the number spilled
+    auto scan = [&](int usable) {
+        std::vector<uint32_t> active; // sorted by end
+        std::vector<bool> taken(usable, false);
+        size_t spilled = 0;
+        for (uint32_t c = 0; c < ra.intervals.size(); ++c) {
+            LiveInterval& cur = ra.intervals[c];
+            cur.reg = -1;
+            size_t expired = 0;
+            while (expired < active.size() && ra.intervals[active[expired]].end < cur.start) {
+                taken[ra.intervals[active[expired]].reg] = false;
+                ++expired;
+            }
+            active.erase(active.begin(), active.begin() + expired);
+
+            int reg = -1;
+            if (hint[c] != NONE) {
+                int h = ra.intervals[hint[c]].reg;
+                if (h >= 0 && !taken[h]) reg = h;
+            }
+            for (int r = 0; reg < 0 && r < usable; ++r) {
+                if (!taken[r]) reg = r;
+            }
+            if (reg < 0 && !active.empty() && ra.intervals[active.back()].end > cur.end) {
+                // the value needed furthest away goes to memory instead
+                LiveInterval& victim = ra.intervals[active.back()];
+                reg = victim.reg;
+                victim.reg = -1;
+                active.pop_back();
+                ++spilled;
+            } else if (reg < 0) {
+                ++spilled;
+                continue;
+            }
+            cur.reg = reg;
+            taken[reg] = true;
+            auto at = std::upper_bound(active.begin(), active.end(), cur.end,
+                                       [&](uint32_t end, uint32_t a) { return end < ra.intervals[a].end; });
+            active.insert(at, c);
+        }
+        return spilled;
+    };
+    st.spilled = scan(registers);
+    if (st.spilled > 0 && scratch > 0) {
+        st.scratch = scratch;
+        st.spilled = scan(registers - st.scratch);
+    }
+
+    // spill slots: a spilled value that outlives its definition is stored;
+    // slots are colored like registers, over whole intervals
+    using Busy = std::pair<uint32_t, int>; // end, slot
+    std::priority_queue<Busy, std::vector<Busy>, std::greater<Busy>> busy;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> freeSlots;
+    for (LiveInterval& iv : ra.intervals) {
+        if (iv.reg >= 0 || iv.literal || iv.end == iv.start) continue;
+        while (!busy.empty() && busy.top().first < iv.start) {
+            freeSlots.push(busy.top().second);
+            busy.pop();
+        }
+        if (freeSlots.empty()) {
+            iv.slot = static_cast<int>(st.slots++);
+        } else {
+            iv.slot = freeSlots.top();
+            freeSlots.pop();
+        }
+        busy.push({iv.end, iv.slot});
+    }
+
+    std::vector<bool> used(registers, false);
+    for (const LiveInterval& iv : ra.intervals) {
+        if (iv.reg >= 0) used[iv.reg] = true;
+    }
+    st.used = static_cast<int>(std::count(used.begin(), used.end(), true)) + st.scratch;
+    return ra;
+}
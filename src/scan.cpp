@@ -0,0 +1,378 @@
+#include "scan.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace scan {
+
+// ---------------------------------------------------------------------------
+// Scalar fallback (also used for the tails of the vector loops)
+
+static inline bool isSpaceByte(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool isIdentByte(char c) {
+    char lower = static_cast<char>(c | 0x20);
+    return (c >= '0' && c <= '9') || (lower >= 'a' && lower <= 'z') || c == '_';
+}
+
+static const char* skipSpaceScalar(const char* p, const char* end, int& lines) {
+    while (p < end && isSpaceByte(*p)) {
+        if (*p == '\n') lines++;
+        p++;
+    }
+    return p;
+}
+
+static const char* identEndScalar(const char* p, const char* end) {
+    while (p < end && isIdentByte(*p)) p++;
+    return p;
+}
+
+static const char* digitEndScalar(const char* p, const char* end) {
+    while (p < end && *p >= '0' && *p <= '9') p++;
+    return p;
+}
+
+static const char* findByteScalar(const char* p, const char* end, char c) {
+    if (p >= end) return end;
+    const void* hit = std::memchr(p, c, static_cast<size_t>(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+static const char* findEitherScalar(const char* p, const char* end, char a, char b) {
+    while (p < end && *p != a && *p != b) p++;
+    return p;
+}
+
+static const char* findCommentCloseScalar(const char* p, const char* end) {
+    while (end - p >= 2) {
+        if (p[0] == '*' && p[1] == '/') return p;
+        p++;
+    }
+    return end;
+}
+
+static int countNewlinesScalar(const char* p, const char* end) {
+    int n = 0;
+    for (; p < end; ++p) n += (*p == '\n');
+    return n;
+}
+
+#ifdef SCAN_X86
+// ---------------------------------------------------------------------------
+// SSE2: 16 bytes per step. Byte classes are built with signed compares, so
+// bytes >= 0x80 (negative) never match a class.
+
+static const char* skipSpaceSSE2(const char* p, const char* end, int& lines) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below = _mm_set1_epi8('\t' - 1);
+    const __m128i above = _mm_set1_epi8('\r' + 1);
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                  _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above)));
+        unsigned wsMask = static_cast<unsigned>(_mm_movemask_epi8(ws));
+        unsigned nlMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+        if (wsMask != 0xFFFFu) {
+            unsigned stop = static_cast<unsigned>(__builtin_ctz(~wsMask));
+            lines += __builtin_popcount(nlMask & ((1u << stop) - 1));
+            return p + stop;
+        }
+        lines += __builtin_popcount(nlMask);
+        p += 16;
+    }
+    return skipSpaceScalar(p, end, lines);
+}
+
+static inline __m128i identClassSSE2(__m128i v) {
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(digit, alpha), under);
+}
+
+static const char* identEndSSE2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(identClassSSE2(v)));
+        if (mask != 0xFFFFu) return p + __builtin_ctz(~mask);
+        p += 16;
+    }
+    return identEndScalar(p, end);
+}
+
+static const char* digitEndSSE2(const char* p, const char* end) {
+    const __m128i below = _mm_set1_epi8('0' - 1);
+    const __m128i above = _mm_set1_epi8('9' + 1);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(digit));
+        if (mask != 0xFFFFu) return p + __builtin_ctz(~mask);
+        p += 16;
+    }
+    return digitEndScalar(p, end);
+}
+
+static const char* findByteSSE2(const char* p, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findByteScalar(p, end, c);
+}
+
+static const char* findEitherSSE2(const char* p, const char* end, char a, char b) {
+    const __m128i na = _mm_set1_epi8(a);
+    const __m128i nb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, na), _mm_cmpeq_epi8(v, nb))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findEitherScalar(p, end, a, b);
+}
+
+static const char* findCommentCloseSSE2(const char* p, const char* end) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    // compare the block against itself shifted by one byte: bit i is set
+    // when p[i] == '*' and p[i + 1] == '/'
+    while (end - p >= 17) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v0, star), _mm_cmpeq_epi8(v1, slash))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findCommentCloseScalar(p, end);
+}
+
+static int countNewlinesSSE2(const char* p, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    int n = 0;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        n += __builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline))));
+        p += 16;
+    }
+    return n + countNewlinesScalar(p, end);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 32 bytes per step. Compiled for AVX2 regardless of the global flags
+// and only called after the CPU check in detect().
+
+#define SCAN_AVX2 __attribute__((target("avx2,popcnt")))
+
+SCAN_AVX2 static const char* skipSpaceAVX2(const char* p, const char* end, int& lines) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i below = _mm256_set1_epi8('\t' - 1);
+    const __m256i above = _mm256_set1_epi8('\r' + 1);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                     _mm256_and_si256(_mm256_cmpgt_epi8(v, below), _mm256_cmpgt_epi8(above, v)));
+        unsigned wsMask = static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        unsigned nlMask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)));
+        if (wsMask != 0xFFFFFFFFu) {
+            unsigned stop = static_cast<unsigned>(__builtin_ctz(~wsMask));
+            lines += __builtin_popcount(nlMask & ((1u << stop) - 1));
+            return p + stop;
+        }
+        lines += __builtin_popcount(nlMask);
+        p += 32;
+    }
+    return skipSpaceSSE2(p, end, lines);
+}
+
+SCAN_AVX2 static const char* identEndAVX2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(digit, alpha), under)));
+        if (mask != 0xFFFFFFFFu) return p + __builtin_ctz(~mask);
+        p += 32;
+    }
+    return identEndSSE2(p, end);
+}
+
+SCAN_AVX2 static const char* digitEndAVX2(const char* p, const char* end) {
+    const __m256i below = _mm256_set1_epi8('0' - 1);
+    const __m256i above = _mm256_set1_epi8('9' + 1);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, below), _mm256_cmpgt_epi8(above, v));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(digit));
+        if (mask != 0xFFFFFFFFu) return p + __builtin_ctz(~mask);
+        p += 32;
+    }
+    return digitEndSSE2(p, end);
+}
+
+SCAN_AVX2 static const char* findByteAVX2(const char* p, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findByteSSE2(p, end, c);
+}
+
+SCAN_AVX2 static const char* findEitherAVX2(const char* p, const char* end, char a, char b) {
+    const __m256i na = _mm256_set1_epi8(a);
+    const __m256i nb = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, na), _mm256_cmpeq_epi8(v, nb))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findEitherSSE2(p, end, a, b);
+}
+
+SCAN_AVX2 static const char* findCommentCloseAVX2(const char* p, const char* end) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    while (end - p >= 33) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v0, star), _mm256_cmpeq_epi8(v1, slash))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findCommentCloseSSE2(p, end);
+}
+
+SCAN_AVX2 static int countNewlinesAVX2(const char* p, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    int n = 0;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        n += __builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline))));
+        p += 32;
+    }
+    return n + countNewlinesSSE2(p, end);
+}
+#endif // SCAN_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+struct Impl {
+    Level level;
+    const char* (*skipSpace)(const char*, const char*, int&);
+    const char* (*identEnd)(const char*, const char*);
+    const char* (*digitEnd)(const char*, const char*);
+    const char* (*findByte)(const char*, const char*, char);
+    const char* (*findEither)(const char*, const char*, char, char);
+    const char* (*findCommentClose)(const char*, const char*);
+    int (*countNewlines)(const char*, const char*);
+};
+
+static const Impl scalarImpl = {Level::Scalar, skipSpaceScalar, identEndScalar, digitEndScalar,
+                                findByteScalar, findEitherScalar, findCommentCloseScalar, countNewlinesScalar};
+#ifdef SCAN_X86
+static const Impl sse2Impl = {Level::SSE2, skipSpaceSSE2, identEndSSE2, digitEndSSE2,
+                              findByteSSE2, findEitherSSE2, findCommentCloseSSE2, countNewlinesSSE2};
+static const Impl avx2Impl = {Level::AVX2, skipSpaceAVX2, identEndAVX2, digitEndAVX2,
+                              findByteAVX2, findEitherAVX2, findCommentCloseAVX2, countNewlinesAVX2};
+#endif
+
+static Level detect() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+#endif
+    return Level::Scalar;
+}
+
+static const Impl* implFor(Level level) {
+#ifdef SCAN_X86
+    if (level == Level::AVX2) return &avx2Impl;
+    if (level == Level::SSE2) return &sse2Impl;
+#endif
+    (void)level;
+    return &scalarImpl;
+}
+
+static const Impl*& current() {
+    static const Impl* impl = implFor(detect());
+    return impl;
+}
+
+Level activeLevel() {
+    return current()->level;
+}
+
+void forceLevel(Level level) {
+    static const Level best = detect();
+    if (static_cast<int>(level) > static_cast<int>(best)) level = best;
+    current() = implFor(level);
+}
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::AVX2: return "AVX2";
+        case Level::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+const char* skipSpace(const char* p, const char* end, int& lines) {
+    return current()->skipSpace(p, end, lines);
+}
+
+const char* identEnd(const char* p, const char* end) {
+    return current()->identEnd(p, end);
+}
+
+const char* digitEnd(const char* p, const char* end) {
+    return current()->digitEnd(p, end);
+}
+
+const char* findByte(const char* p, const char* end, char c) {
+    return current()->findByte(p, end, c);
+}
+
+const char* findEither(const char* p, const char* end, char a, char b) {
+    return current()->findEither(p, end, a, b);
+}
+
+const char* findCommentClose(const char* p, const char* end) {
+    return current()->findCommentClose(p, end);
+}
+
+int countNewlines(const char* p, const char* end) {
+    return current()->countNewlines(p, end);
+}
+
+}
@@ -3,43 +3,212 @@
 #include <vector>
 #include <stdexcept>
 
-// Minimal semantic analyzer implementation to satisfy the linker.
-// Expand with real checks as needed.
+SemanticAnalyzer::SemanticAnalyzer(const SymbolTable& symbols) : symbols(symbols) {}
+
+void SemanticAnalyzer::declare(Symbol name) {
+    if (name >= declared.size()) declared.resize(symbols.size(), false);
+    declared[name] = true;
+}
+
+bool SemanticAnalyzer::isDeclared(Symbol name) const {
+    return name < declared.size() && declared[name];
+}
+
+SemanticAnalyzer::VariableState& SemanticAnalyzer::variable(Symbol name) {
+    if (name >= variables.size()) variables.resize(symbols.size());
+    return variables[name];
+}
+
+// A literal is a String if it holds a character that no number has (a
+// number is white space, a sign and digits); "12" or " " may be part of one.
+ValueType SemanticAnalyzer::literalType(Symbol text) const {
+    for (char c : symbols.name(text)) {
+        bool space = c == ' ' || (c >= '\t' && c <= '\r');
+        if (!space && c != '+' && c != '-' && (c < '0' || c > '9')) return ValueType::String;
+    }
+    return ValueType::Unknown;
+}
+
+ValueType SemanticAnalyzer::read(Symbol name, bool& mayFail) {
+    const VariableState& v = variable(name);
+    if (!v.certain) mayFail = true;
+    return v.assigned ? v.type : ValueType::Unknown;
+}
+
+// Type of `left op right`. `mayFail` is set if the operator can fail at run
+// time, `fails` if it always does.
+ValueType SemanticAnalyzer::operation(char op, ValueType left, ValueType right, bool constantDivisor, bool& mayFail,
+                                      bool& fails) {
+    const ValueType INT = ValueType::Int, STRING = ValueType::String;
+    if (op == '+') {
+        if (left == INT && right == INT) return INT;
+        return left == STRING || right == STRING ? STRING : ValueType::Unknown;
+    }
+    if (left == STRING || right == STRING) fails = true;
+    else if (left != INT || right != INT || (op == '/' && !constantDivisor)) mayFail = true;
+    return INT; // whenever it succeeds
+}
+
+// A statement that fails leaves its target as it was
+void SemanticAnalyzer::assign(Symbol target, ValueType value, bool mayFail, bool fails) {
+    VariableState& v = variable(target);
+    if (fails) return;
+    if (!mayFail) {
+        v = {value, true, true};
+        return;
+    }
+    v.type = v.assigned && v.type != value ? ValueType::Unknown : value;
+    v.assigned = true;
+}
+
+void SemanticAnalyzer::typeError(char op, int line) {
+    const char* verb = op == '-' ? "subtract" : op == '*' ? "multiply" : "divide";
+    errors.push_back(std::string("Cannot ") + verb + " non-numeric values at line " + std::to_string(line));
+}
+
+// Check every statement in order, typing each node as it goes.
 void SemanticAnalyzer::analyze(const std::vector<ASTNode*>& nodes) {
     for (auto n : nodes) {
         analyzeNode(n);
     }
 }
 
-void SemanticAnalyzer::analyzeNode(ASTNode* node) {
-    if (!node) return;
+// Walks the tree with an explicit stack (left subtree first, as a recursive
+// walk would) so deeply nested expressions cannot overflow the native stack.
+// A node is visited again once its operands are done, to give it its type.
+void SemanticAnalyzer::analyzeNode(ASTNode* root) {
+    work.clear();
+    work.push_back({root, false});
+    bool mayFail = false, fails = false;
+    auto typeOf = [](const ASTNode* n) { return n ? n->type : ValueType::Unknown; };
 
-    // Assignment introduces variable (variable name is stored in `name`)
-    if (node->type == "assign") {
-        declared[node->name] = true;
-        analyzeNode(node->left);
-        return;
-    }
+    while (!work.empty()) {
+        auto [node, expanded] = work.back();
+        work.pop_back();
+        if (!node) continue;
+
+        switch (node->kind) {
+            // Assignment introduces variable (variable name is stored in `symbol`)
+            case NodeKind::Assign:
+                if (expanded) {
+                    assign(node->symbol, typeOf(node->left), mayFail, fails);
+                    break;
+                }
+                declare(node->symbol);
+                work.push_back({node, true});
+                work.push_back({node->left, false});
+                break;
+
+            // Variable usage must be declared
+            case NodeKind::Variable:
+                if (!isDeclared(node->symbol)) {
+                    throw std::runtime_error("Use of undeclared variable: " + symbols.name(node->symbol) + " at line " + std::to_string(node->line));
+                }
+                node->type = read(node->symbol, mayFail);
+                break;
 
-    // Variable usage must be declared
-    if (node->type == "variable") {
-        if (!declared.count(node->name)) {
-            throw std::runtime_error("Use of undeclared variable: " + node->name + " at line " + std::to_string(node->line));
+            // binary operation checks
+            case NodeKind::BinOp: {
+                if (!expanded) {
+                    work.push_back({node, true});
+                    work.push_back({node->right, false});
+                    work.push_back({node->left, false});
+                    break;
+                }
+                bool constantDivisor = node->right && node->right->kind == NodeKind::Number && node->right->number != 0;
+                bool failed = fails;
+                node->type = operation(node->op, typeOf(node->left), typeOf(node->right), constantDivisor, mayFail, fails);
+                if (fails && !failed) typeError(node->op, node->line);
+                break;
+            }
+
+            case NodeKind::Cin:
+                declare(node->symbol);
+                assign(node->symbol, ValueType::Unknown, false, false);
+                break;
+
+            case NodeKind::Cout:
+                work.push_back({node->left, false});// output statement are checked to ensure the expression is semantically valid
+                break;
+
+            case NodeKind::Number:
+                node->type = ValueType::Int;
+                break;
+
+            case NodeKind::String:
+                node->type = literalType(node->symbol);
+                break;
         }
-        return;
     }
-    // binary operation checks
-    if (node->type == "binop") {
-        analyzeNode(node->left);
-        analyzeNode(node->right);
-        return;
+}
+
+void SemanticAnalyzer::analyze(const FlatAST& ast) {
+    NodeIndex i = resolve(ast).undeclared;
+    if (i != NO_NODE) {
+        throw std::runtime_error("Use of undeclared variable: " + symbols.name(static_cast<Symbol>(ast.payload[i])) + " at line " + std::to_string(ast.line[i]));
     }
+}
 
-    if (node->type == "cout" || node->type == "cin") {
-        if (node->type == "cin" && !node->name.empty()) {
-            declared[node->name] = true;
+// Slots, definite assignment and types come out of the same walk as the
+// declaration check. A statement is sure to assign its target when nothing
+// in its value can fail: variables it reads are assigned, and it has no
+// "-", "*" or "/" that is not proven to act on ints (nor a "/" by anything
+// but a nonzero constant); "+" never fails. cin always assigns.
+Resolution SemanticAnalyzer::resolve(const FlatAST& ast) {
+    Resolution r;
+    r.slotOf.assign(symbols.size(), UINT32_MAX);
+    r.assigned.assign(ast.size(), false);
+    r.types.assign(ast.size(), ValueType::Unknown);
+    auto slot = [&](Symbol name) {
+        if (r.slotOf[name] == UINT32_MAX) {
+            r.slotOf[name] = static_cast<uint32_t>(r.slots.size());
+            r.slots.push_back(name);
+        }
+    };
+
+    for (size_t s = 0; s < ast.statements.size(); ++s) {
+        NodeIndex root = ast.statements[s];
+        // the statement's target is declared before its value is checked,
+        // exactly as analyzeNode does for "assign" and "cin"
+        bool assigns = ast.kind[root] == NodeKind::Assign || ast.kind[root] == NodeKind::Cin;
+        Symbol target = assigns ? static_cast<Symbol>(ast.payload[root]) : NO_SYMBOL;
+        if (assigns) declare(target);
+
+        bool mayFail = false, fails = false;
+        for (NodeIndex i = ast.begin(s); i < root; ++i) {
+            switch (ast.kind[i]) {
+                case NodeKind::Number:
+                    r.types[i] = ValueType::Int;
+                    break;
+                case NodeKind::String:
+                    r.types[i] = literalType(static_cast<Symbol>(ast.payload[i]));
+                    break;
+                case NodeKind::Variable: {
+                    Symbol name = static_cast<Symbol>(ast.payload[i]);
+                    if (!isDeclared(name) && r.undeclared == NO_NODE) r.undeclared = i;
+                    slot(name);
+                    r.assigned[i] = variable(name).certain;
+                    r.types[i] = read(name, mayFail);
+                    break;
+                }
+                case NodeKind::BinOp: {
+                    NodeIndex right = ast.rhs[i];
+                    bool constantDivisor = ast.kind[right] == NodeKind::Number && ast.payload[right] != 0;
+                    char op = static_cast<char>(ast.payload[i]);
+                    bool failed = fails;
+                    r.types[i] = operation(op, r.types[ast.lhs[i]], r.types[right], constantDivisor, mayFail, fails);
+                    if (fails && !failed) typeError(op, ast.line[i]);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        if (assigns) {
+            slot(target);
+            if (ast.kind[root] == NodeKind::Cin) assign(target, ValueType::Unknown, false, false);
+            else assign(target, ast.lhs[root] == NO_NODE ? ValueType::Unknown : r.types[ast.lhs[root]], mayFail, fails);
         }
-        analyzeNode(node->left);// output statement are checked to ensure the expression is semantically valid
-        return;
     }
+    return r;
 }
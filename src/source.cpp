@@ -0,0 +1,88 @@
+#include "source.h"
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceFile::SourceFile() : data(""), size(0), mapped(false) {}
+
+SourceFile::~SourceFile() {
+    release();
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept : data(""), size(0), mapped(false) {
+    *this = std::move(other);
+}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    mapped = other.mapped;
+    size = other.size;
+    if (mapped) {
+        data = other.data;
+    } else {
+        owned = std::move(other.owned);
+        data = owned.data();
+    }
+    other.data = "";
+    other.size = 0;
+    other.mapped = false;
+    return *this;
+}
+
+void SourceFile::release() {
+#if !defined(_WIN32)
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    owned.clear();
+    data = "";
+    size = 0;
+    mapped = false;
+}
+
+void SourceFile::assign(std::string_view text) {
+    release();
+    owned.assign(text.data(), text.size());
+    data = owned.data();
+    size = owned.size();
+}
+
+bool SourceFile::open(const std::string& path) {
+    release();
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            // the lexer walks the file front to back exactly once
+            madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            ::close(fd);
+            data = static_cast<const char*>(p);
+            size = static_cast<size_t>(st.st_size);
+            mapped = true;
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    // fallback: read the whole file into owned storage
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    owned = buffer.str();
+    data = owned.data();
+    size = owned.size();
+    return true;
+}
@@ -0,0 +1,151 @@
+#include "ssa.h"
+#include <algorithm>
+
+ValueFacts intConstant(int64_t value) {
+    ValueFacts f;
+    f.isConst = true;
+    f.constant = value;
+    f.isInt = true;
+    return f;
+}
+
+ValueFacts arithmeticResult(IROp op, const ValueFacts& a, const ValueFacts& b) {
+    ValueFacts f;
+    // "+" on anything but two numbers concatenates; the others either
+    // produce an int or raise an error
+    switch (op) {
+        case IROp::Add: f.isInt = a.numeric() && b.numeric(); break;
+        case IROp::Concat: f.isInt = false; break;
+        default: f.isInt = true; break;
+    }
+    return f;
+}
+
+bool arithmeticCanFault(IROp op, const ValueFacts& a, const ValueFacts& b) {
+    switch (op) {
+        case IROp::Add:
+        case IROp::IAdd:
+        case IROp::ISub:
+        case IROp::IMul:
+        case IROp::Concat:
+            return false;
+        case IROp::Sub:
+        case IROp::Mul:
+            return !(a.numeric() && b.numeric());
+        case IROp::Div:
+            return !a.numeric() || !b.isConst || b.constant == 0;
+        case IROp::IDiv:
+            return !b.isConst || b.constant == 0;
+        default:
+            return false;
+    }
+}
+
+bool foldArithmetic(IROp op, int64_t a, int64_t b, int64_t& result) {
+    // the interpreter computes on 64-bit ints; do the same with wrap-around
+    uint64_t ua = static_cast<uint64_t>(a), ub = static_cast<uint64_t>(b);
+    if (op == IROp::Concat) return false;
+    switch (untypedOp(op)) {
+        case IROp::Add: result = static_cast<int64_t>(ua + ub); return true;
+        case IROp::Sub: result = static_cast<int64_t>(ua - ub); return true;
+        case IROp::Mul: result = static_cast<int64_t>(ua * ub); return true;
+        case IROp::Div:
+            if (b == 0) return false;
+            result = b == -1 ? static_cast<int64_t>(0 - ua) : a / b; // INT64_MIN / -1 wraps
+            return true;
+        default:
+            return false;
+    }
+}
+
+SSAInfo SSAInfo::build(const IRProgram& ir) {
+    SSAInfo ssa;
+    size_t n = ir.code.size();
+    ssa.version.assign(n, NO_VERSION);
+    ssa.statement.assign(n, 0);
+    ssa.canFault.assign(n, false);
+    ssa.tempDef.assign(ir.temps + 1, NO_DEF);
+    ssa.tempUses.assign(ir.temps + 1, 0);
+
+    Symbol vars = 0;
+    for (const IRInstruction& ins : ir.code) {
+        for (int k = 0; k < 3; ++k) {
+            if (ins.kinds[k] == OperandKind::Var) vars = std::max(vars, ins.ids[k] + 1);
+        }
+    }
+    std::vector<uint32_t> current(vars, NO_VERSION); // per variable
+    std::vector<bool> defined(vars, false);          // certainly assigned by now
+    std::vector<ValueFacts> temps(ir.temps + 1);
+
+    auto versionOf = [&](Symbol var) {
+        if (current[var] == NO_VERSION) {
+            current[var] = static_cast<uint32_t>(ssa.versionVar.size());
+            ssa.versionVar.push_back(var);
+            ssa.versionDef.push_back(NO_DEF);
+        }
+        return current[var];
+    };
+    auto newVersion = [&](Symbol var, uint32_t def) {
+        current[var] = static_cast<uint32_t>(ssa.versionVar.size());
+        ssa.versionVar.push_back(var);
+        ssa.versionDef.push_back(def);
+        return current[var];
+    };
+    auto facts = [&](Operand o) {
+        if (o.kind == OperandKind::Temp) return temps[o.id];
+        if (o.kind == OperandKind::Int) return intConstant(ir.intValue(o));
+        return ValueFacts();
+    };
+
+    uint32_t stmt = 0;
+    bool prefixSafe = true; // nothing earlier in this statement can fault
+    for (uint32_t i = 0; i < n; ++i) {
+        const IRInstruction& ins = ir.code[i];
+        Operand a = ins.arg1(), b = ins.arg2(), res = ins.result();
+        ssa.statement[i] = stmt;
+
+        bool fault = false;
+        switch (ins.op) {
+            case IROp::Nop:
+                break;
+            case IROp::Mov:
+                temps[res.id] = facts(a);
+                break;
+            case IROp::Load:
+                ssa.version[i] = versionOf(a.id);
+                fault = !defined[a.id]; // "Undefined variable"
+                break;
+            case IROp::Store:
+                ssa.version[i] = newVersion(res.id, i);
+                // skipped if an earlier part of the statement faults
+                if (prefixSafe) defined[res.id] = true;
+                break;
+            case IROp::Read:
+                ssa.version[i] = newVersion(res.id, i);
+                defined[res.id] = true;
+                break;
+            case IROp::Print:
+                if (a.kind == OperandKind::Var) {
+                    ssa.version[i] = versionOf(a.id);
+                    fault = !defined[a.id];
+                }
+                break;
+            default:
+                fault = arithmeticCanFault(ins.op, facts(a), facts(b));
+                temps[res.id] = arithmeticResult(ins.op, facts(a), facts(b));
+                break;
+        }
+        ssa.canFault[i] = fault;
+        prefixSafe = prefixSafe && !fault;
+
+        if (a.kind == OperandKind::Temp) ++ssa.tempUses[a.id];
+        if (b.kind == OperandKind::Temp) ++ssa.tempUses[b.id];
+        if (res.kind == OperandKind::Temp) ssa.tempDef[res.id] = i;
+
+        if (endsStatement(ins.op)) {
+            ++stmt;
+            prefixSafe = true;
+        }
+    }
+    return ssa;
+}
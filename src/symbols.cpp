@@ -0,0 +1,11 @@
+#include "symbols.h"
+
+Symbol SymbolTable::intern(std::string_view text) {
+    auto it = ids.find(text);
+    if (it != ids.end()) return it->second;
+
+    Symbol id = static_cast<Symbol>(names.size());
+    names.emplace_back(text);
+    ids.emplace(std::string_view(names.back()), id);
+    return id;
+}
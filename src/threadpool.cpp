@@ -0,0 +1,66 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+    : task(nullptr), count(0), next(0), active(0), generation(0), stopping(false) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (size_t i = 1; i < threads; ++i) workers.emplace_back(&ThreadPool::workerMain, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+// claim indices of the current loop until none are left
+void ThreadPool::drain() {
+    for (;;) {
+        size_t i = next.fetch_add(1);
+        if (i >= count) return;
+        (*task)(i);
+    }
+}
+
+void ThreadPool::workerMain() {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    if (n == 0) return;
+    if (workers.empty() || n == 1) {
+        for (size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        count = n;
+        next = 0;
+        active = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return active == 0; });
+    task = nullptr;
+}
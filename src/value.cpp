@@ -0,0 +1,98 @@
+#include "value.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+// A body of `used` bytes with room for `capacity`
+StringBody* allocate(size_t used, size_t capacity) {
+    void* memory = std::malloc(sizeof(StringBody) + capacity);
+    if (!memory) throw std::bad_alloc();
+    StringBody* body = static_cast<StringBody*>(memory);
+    body->refs = 1;
+    body->numeric = -1;
+    body->numericLength = 0;
+    body->number = 0;
+    body->used = used;
+    body->capacity = capacity;
+    return body;
+}
+
+Value view(StringBody* body) {
+    Value v;
+    v.s = body;
+    v.length = static_cast<uint32_t>(body->used);
+    v.kind = Value::Kind::Str;
+    return v;
+}
+
+// Text of an int value or a string value, the int written into `buffer`.
+std::string_view textOf(const Value& v, char (&buffer)[24]) {
+    if (v.kind == Value::Kind::Str) return v.text();
+    return {buffer, static_cast<size_t>(std::to_chars(buffer, buffer + sizeof buffer, v.i).ptr - buffer)};
+}
+
+}
+
+bool parseNumber(std::string_view text, int64_t& out) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p == end || *p < '0' || *p > '9') return false;
+    uint64_t limit = negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(INT64_MAX);
+    uint64_t n = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        unsigned digit = static_cast<unsigned>(*p - '0');
+        if (n > (limit - digit) / 10) return false; // out of range
+        n = n * 10 + digit;
+    }
+    if (p != end) return false;
+    out = static_cast<int64_t>(negative ? 0 - n : n);
+    return true;
+}
+
+Value Value::string(std::string_view text) {
+    if (text.size() > UINT32_MAX) throw std::length_error("string longer than 4 GiB");
+    StringBody* body = allocate(text.size(), text.size());
+    std::memcpy(body->text(), text.data(), text.size());
+    return view(body);
+}
+
+Value Value::concat(const Value& left, const Value& right) {
+    char a[24], b[24];
+    std::string_view l = textOf(left, a), r = textOf(right, b);
+    size_t length = l.size() + r.size();
+    if (length > UINT32_MAX) throw std::length_error("string longer than 4 GiB");
+
+    // left ends where its body's bytes end: append after it
+    if (left.kind == Kind::Str && left.length == left.s->used && length <= left.s->capacity) {
+        StringBody* body = left.s;
+        std::memcpy(body->text() + body->used, r.data(), r.size()); // r may be in body, never past used
+        body->used = length;
+        ++body->refs;
+        return view(body);
+    }
+    // room to grow: the next appends to this result go in place
+    StringBody* body = allocate(length, length < 32 ? 32 : length * 2);
+    std::memcpy(body->text(), l.data(), l.size());
+    std::memcpy(body->text() + l.size(), r.data(), r.size());
+    return view(body);
+}
+
+void Value::release(StringBody* body) {
+    if (--body->refs == 0) std::free(body);
+}
+
+bool Value::stringNumber(StringBody* body, uint32_t length, int64_t& out) {
+    if (body->numeric < 0 || body->numericLength != length) {
+        body->numeric = parseNumber({body->text(), length}, body->number) ? 1 : 0;
+        body->numericLength = length;
+    }
+    out = body->number;
+    return body->numeric != 0;
+}
@@ -0,0 +1,509 @@
+#include "x86.h"
+#include "regalloc.h"
+#include "ssa.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+const X86Reg ALLOCATABLE[X86CodeGenerator::REGISTERS] = {X86Reg::RBX, X86Reg::RBP, X86Reg::R12,
+                                                         X86Reg::R13, X86Reg::R14, X86Reg::R15};
+
+bool fitsInt32(int64_t v) {
+    return v == static_cast<int32_t>(v);
+}
+
+// whether integer v has an immediate word (n * 2 + 1 in 64 bits)
+bool fitsWord(int64_t v) {
+    return v >= -(INT64_C(1) << 62) && v < (INT64_C(1) << 62);
+}
+
+}
+
+std::vector<Symbol> lowerToX86(const IRProgram& ir, const RegisterAllocation& ra, X86Emitter& out) {
+    using Label = X86Emitter::Label;
+    using Alu = X86Emitter::Alu;
+    using Helper = X86Emitter::Helper;
+    const X86Arg rax = X86Arg::reg(X86Reg::RAX), rdx = X86Arg::reg(X86Reg::RDX);
+
+    // variables, numbered in order of appearance
+    Symbol maxVar = 0;
+    for (const IRInstruction& ins : ir.code) {
+        for (int k = 0; k < 3; ++k) {
+            if (ins.kinds[k] == OperandKind::Var) maxVar = std::max(maxVar, ins.ids[k]);
+        }
+    }
+    std::vector<uint32_t> varIndex(maxVar + 1, UINT32_MAX);
+    std::vector<Symbol> vars;
+    auto variable = [&](Symbol name) {
+        if (varIndex[name] == UINT32_MAX) {
+            varIndex[name] = static_cast<uint32_t>(vars.size());
+            vars.push_back(name);
+        }
+        return X86Arg{X86Arg::Var, varIndex[name]};
+    };
+
+    // six pushes leave the stack 8 bytes off the 16 the ABI wants at calls
+    int32_t frame = static_cast<int32_t>(ra.stats.slots * 8);
+    if (frame % 16 == 0) frame += 8;
+    out.section(false);
+    for (X86Reg r : ALLOCATABLE) out.pushq(r);
+    out.addRsp(-frame);
+
+    Label statementEnd = 0;
+    bool open = false; // the current statement has instructions
+
+    // whether the value of interval `iv` is kept anywhere (it is read later)
+    auto located = [&](uint32_t iv) {
+        const LiveInterval& l = ra.intervals[iv];
+        return l.reg >= 0 || l.slot >= 0;
+    };
+    auto location = [&](uint32_t iv) {
+        const LiveInterval& l = ra.intervals[iv];
+        if (l.reg >= 0) return X86Arg::reg(ALLOCATABLE[l.reg]);
+        return X86Arg{X86Arg::Slot, l.slot};
+    };
+    // load variable `name` into `reg`, abandoning the statement if it was
+    // never assigned
+    auto loadVariable = [&](Symbol name, X86Reg reg, size_t idx) {
+        X86Arg v = variable(name);
+        out.movq(X86Arg::reg(reg), v);
+        out.testq(reg, reg);
+        Label undefined = out.label();
+        out.jz(undefined);
+        out.section(true);
+        out.bind(undefined);
+        out.movq(X86Arg::reg(X86Reg::RDI), {X86Arg::Name, v.value});
+        out.movq(X86Arg::reg(X86Reg::RSI), {X86Arg::Imm, ir.line(idx)});
+        out.call(Helper::Undefined);
+        out.jmp(statementEnd);
+        out.section(false);
+    };
+    // argument k of instruction idx as a movq source: a register, a slot,
+    // an immediate, or `scratch` after loading it there
+    auto source = [&](size_t idx, int k, X86Reg scratch) -> X86Arg {
+        const IRInstruction& ins = ir.code[idx];
+        Operand o = k == 0 ? ins.arg1() : ins.arg2();
+        switch (o.kind) {
+            case OperandKind::Temp:
+                return location(ra.operand[idx * 2 + k]);
+            case OperandKind::Int: {
+                int64_t v = ir.intValue(o);
+                if (fitsWord(v)) {
+                    X86Arg word{X86Arg::Imm, v * 2 + 1};
+                    if (fitsInt32(word.value)) return word;
+                    out.movq(X86Arg::reg(scratch), word);
+                } else {
+                    // too wide for a word: kept as its digits
+                    out.movq(X86Arg::reg(scratch), {X86Arg::Big, v});
+                }
+                return X86Arg::reg(scratch);
+            }
+            case OperandKind::Str:
+                out.movq(X86Arg::reg(scratch), {X86Arg::Str, o.id});
+                return X86Arg::reg(scratch);
+            case OperandKind::Var:
+                loadVariable(o.id, scratch, idx);
+                return X86Arg::reg(scratch);
+            default:
+                return {X86Arg::Imm, 0};
+        }
+    };
+    auto load = [&](size_t idx, int k, X86Reg reg) {
+        X86Arg s = source(idx, k, reg);
+        if (!s.isReg() || s.r() != reg) out.movq(X86Arg::reg(reg), s);
+    };
+    // `reg` into the result of instruction idx
+    auto storeResult = [&](size_t idx, X86Reg reg) {
+        if (located(ra.result[idx])) out.movq(location(ra.result[idx]), X86Arg::reg(reg));
+    };
+
+    size_t note = 0;
+    auto notesBefore = [&](size_t idx) {
+        for (; note < ir.notes.size() && ir.notes[note].before <= idx; ++note) {
+            const std::string& n = ir.notes[note].text;
+            out.comment(n.rfind("; ", 0) == 0 ? n.substr(2) : n);
+        }
+    };
+    for (size_t idx = 0; idx < ir.code.size(); ++idx) {
+        notesBefore(idx);
+        const IRInstruction& ins = ir.code[idx];
+        if (!open) {
+            statementEnd = out.label();
+            open = true;
+        }
+        switch (ins.op) {
+            case IROp::Mov:
+            case IROp::Load: {
+                bool used = located(ra.result[idx]);
+                X86Arg dst = used ? location(ra.result[idx]) : rax;
+                bool inRegister = used && dst.isReg();
+                if (ins.op == IROp::Load) {
+                    // the check stays even if the value is unused
+                    loadVariable(ins.ids[0], inRegister ? dst.r() : X86Reg::RAX, idx);
+                    if (used && !inRegister) out.movq(dst, rax);
+                } else if (used) {
+                    X86Arg s = source(idx, 0, inRegister ? dst.r() : X86Reg::RAX);
+                    if (s.kind != dst.kind || s.value != dst.value) {
+                        if (inRegister || s.isReg() || s.kind == X86Arg::Imm) {
+                            out.movq(dst, s);
+                        } else {
+                            out.movq(rax, s);
+                            out.movq(dst, rax);
+                        }
+                    }
+                }
+                break;
+            }
+
+            case IROp::Store: {
+                X86Arg s = source(idx, 0, X86Reg::RAX);
+                if (!s.isReg()) {
+                    out.movq(rax, s);
+                    s = rax;
+                }
+                out.movq(variable(ins.ids[2]), s);
+                break;
+            }
+
+            case IROp::Print:
+                load(idx, 0, X86Reg::RDI);
+                out.call(Helper::Print);
+                break;
+
+            case IROp::Read:
+                out.call(Helper::Read);
+                out.movq(variable(ins.ids[2]), rax);
+                break;
+
+            case IROp::Nop:
+                break;
+
+            case IROp::Concat:
+                // an operand is never a number: straight to the runtime
+                load(idx, 0, X86Reg::RDI);
+                load(idx, 1, X86Reg::RSI);
+                out.call(Helper::Concat);
+                storeResult(idx, X86Reg::RAX);
+                break;
+
+            case IROp::Add:
+            case IROp::Sub:
+            case IROp::Mul:
+            case IROp::Div:
+            case IROp::IAdd:
+            case IROp::ISub:
+            case IROp::IMul:
+            case IROp::IDiv: {
+                // Words are n * 2 + 1, so the sum of a and b is a + (b - 1),
+                // their difference (a - b) | 1 and their product
+                // (a >> 1) * (b - 1) | 1. The overflow flag says whether
+                // the result still fits in a word. A constant right operand
+                // stays an immediate: no tag test for it, and a known
+                // divisor needs no checks. Typed ops keep the tag test: an
+                // int too wide for a word is still a pointer.
+                IROp op = untypedOp(ins.op);
+                Operand b = ins.arg2();
+                int64_t c = b.kind == OperandKind::Int ? ir.intValue(b) : 0;
+                bool constant = b.kind == OperandKind::Int && fitsInt32(c) && fitsInt32(c * 2 + 1);
+                X86Reg result = op == IROp::Div ? X86Reg::RAX : X86Reg::RCX;
+                const X86Arg rcx = X86Arg::reg(X86Reg::RCX), rsi = X86Arg::reg(X86Reg::RSI);
+                Label slow = out.label(), done = out.label();
+                load(idx, 0, X86Reg::RAX);
+                if (constant) {
+                    out.testLowBit(X86Reg::RAX);
+                    out.jz(slow);
+                    if (op == IROp::Div && (c == 0 || c == -1)) out.jmp(slow);
+                } else {
+                    load(idx, 1, X86Reg::RDX);
+                    // both immediate integers?
+                    out.movq(rcx, rax);
+                    out.aluq(Alu::And, X86Reg::RCX, rdx);
+                    out.testLowBit(X86Reg::RCX);
+                    out.jz(slow);
+                    if (op == IROp::Div) {
+                        // divisors 0 and -1 (words 1 and -1) take the slow path
+                        out.cmpq(X86Reg::RDX, 1);
+                        out.jz(slow);
+                        out.cmpq(X86Reg::RDX, -1);
+                        out.jz(slow);
+                    }
+                }
+                // %rax keeps the left operand's word until nothing can
+                // overflow any more
+                switch (op) {
+                    case IROp::Add:
+                        if (constant) {
+                            out.movq(rcx, rax);
+                            out.aluq(Alu::Add, X86Reg::RCX, {X86Arg::Imm, c * 2});
+                        } else {
+                            out.movq(rcx, rdx);
+                            out.aluq(Alu::Sub, X86Reg::RCX, {X86Arg::Imm, 1});
+                            out.aluq(Alu::Add, X86Reg::RCX, rax);
+                        }
+                        out.jo(slow);
+                        break;
+                    case IROp::Sub:
+                        out.movq(rcx, rax);
+                        out.aluq(Alu::Sub, X86Reg::RCX, constant ? X86Arg{X86Arg::Imm, c * 2} : rdx);
+                        out.jo(slow);
+                        if (!constant) out.aluq(Alu::Or, X86Reg::RCX, {X86Arg::Imm, 1});
+                        break;
+                    case IROp::Mul:
+                        out.movq(rcx, rax);
+                        out.sarq1(X86Reg::RCX);
+                        if (constant) {
+                            out.aluq(Alu::Imul, X86Reg::RCX, {X86Arg::Imm, c * 2});
+                        } else {
+                            out.movq(rsi, rdx);
+                            out.aluq(Alu::Sub, X86Reg::RSI, {X86Arg::Imm, 1});
+                            out.aluq(Alu::Imul, X86Reg::RCX, rsi);
+                        }
+                        out.jo(slow);
+                        out.aluq(Alu::Or, X86Reg::RCX, {X86Arg::Imm, 1});
+                        break;
+                    default:
+                        // a quotient is no wider than the dividend
+                        out.sarq1(X86Reg::RAX);
+                        if (constant) {
+                            out.movq(rcx, {X86Arg::Imm, c});
+                        } else {
+                            out.movq(rcx, rdx);
+                            out.sarq1(X86Reg::RCX);
+                        }
+                        out.cqto();
+                        out.idivq(X86Reg::RCX);
+                        out.tag(X86Reg::RAX);
+                        break;
+                }
+                out.bind(done);
+                storeResult(idx, result);
+
+                // %rax still holds the left operand's word when jumping here
+                out.section(true);
+                out.bind(slow);
+                out.movq(X86Arg::reg(X86Reg::RDI), rax);
+                out.movq(rsi, constant ? X86Arg{X86Arg::Imm, c * 2 + 1} : rdx);
+                out.movq(rdx, {X86Arg::Imm, ir.line(idx)});
+                out.call(op == IROp::Add ? Helper::Add : op == IROp::Sub ? Helper::Sub
+                         : op == IROp::Mul ? Helper::Mul : Helper::Div);
+                if (op != IROp::Add) {
+                    out.testq(X86Reg::RAX, X86Reg::RAX);
+                    out.jz(statementEnd);
+                }
+                if (result != X86Reg::RAX) out.movq(X86Arg::reg(result), rax);
+                out.jmp(done);
+                out.section(false);
+                break;
+            }
+        }
+
+        if (endsStatement(ins.op)) {
+            out.bind(statementEnd);
+            open = false;
+        }
+    }
+    if (open) out.bind(statementEnd);
+    notesBefore(ir.code.size());
+
+    out.addRsp(frame);
+    for (int r = X86CodeGenerator::REGISTERS; r-- > 0;) out.popq(ALLOCATABLE[r]);
+    out.movq(rax, {X86Arg::Imm, 0});
+    out.ret();
+    return vars;
+}
+
+namespace {
+
+const char* const NAMES64[16] = {"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+                                 "%r8",  "%r9",  "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"};
+const char* const NAMES8[4] = {"%al", "%cl", "%dl", "%bl"};
+const char* const HELPERS[8] = {"rt_add",       "rt_sub",   "rt_mul",  "rt_div",
+                                "rt_undefined", "rt_print", "rt_read", "rt_concat"};
+
+// Bytes for .ascii: printable characters as they are, the rest in octal.
+std::string quoted(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\') {
+            out += static_cast<char>(c);
+        } else {
+            char buf[5];
+            std::snprintf(buf, sizeof buf, "\\%03o", c);
+            out += buf;
+        }
+    }
+    return out + "\"";
+}
+
+// An rt_string object in .data (numeric is worked out at run time).
+void stringObject(std::string& data, const std::string& label, const std::string& text) {
+    data += "\t.p2align 3\n" + label + ":\n\t.quad " + std::to_string(text.size()) + "\n\t.long -1, 0\n\t.quad 0\n\t.ascii " +
+            quoted(text) + "\n\t.byte 0\n";
+}
+
+// Shell word for std::system.
+std::string shellQuote(const std::string& s) {
+    std::string out = "'";
+    for (char c : s) out += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    return out + "'";
+}
+
+// The lowering as GNU assembler text. Instructions are appended piece by
+// piece, without temporaries: a big program is millions of them.
+class TextEmitter : public X86Emitter {
+private:
+    const SymbolTable& symbols;
+    std::string text, cold, data;
+    std::string* cur = &text;
+    uint32_t labels = 0, bigs = 0;
+    std::vector<bool> stringDone;
+
+    void number(int64_t v) {
+        char buf[24];
+        cur->append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+    }
+    void put(X86Reg r) { *cur += NAMES64[static_cast<int>(r)]; }
+    void put(Label l) { *cur += ".L", number(l); }
+    void put(X86Arg a) {
+        switch (a.kind) {
+            case X86Arg::Reg: put(a.r()); break;
+            case X86Arg::Slot: number(a.value * 8), *cur += "(%rsp)"; break;
+            case X86Arg::Imm: *cur += '$', number(a.value); break;
+            case X86Arg::Var: *cur += ".Lvars+", number(a.value * 8), *cur += "(%rip)"; break;
+            case X86Arg::Str:
+                if (!stringDone[a.value]) {
+                    stringDone[a.value] = true;
+                    stringObject(data, ".Ls" + std::to_string(a.value), symbols.name(static_cast<Symbol>(a.value)));
+                }
+                *cur += ".Ls", number(a.value), *cur += "(%rip)";
+                break;
+            case X86Arg::Big:
+                stringObject(data, ".Lb" + std::to_string(bigs), std::to_string(a.value));
+                *cur += ".Lb", number(bigs++), *cur += "(%rip)";
+                break;
+            case X86Arg::Name: *cur += ".Ln", number(a.value), *cur += "(%rip)"; break;
+        }
+    }
+    // "\tmnemonic a, b\n"
+    template <typename A, typename B>
+    void ins(std::string_view mnemonic, A a, B b) {
+        *cur += '\t', cur->append(mnemonic), *cur += ' ';
+        put(a);
+        *cur += ", ";
+        put(b);
+        *cur += '\n';
+    }
+    template <typename A>
+    void ins(std::string_view mnemonic, A a) {
+        *cur += '\t', cur->append(mnemonic), *cur += ' ';
+        put(a);
+        *cur += '\n';
+    }
+
+public:
+    TextEmitter(const SymbolTable& symbols, size_t instructions)
+        : symbols(symbols), stringDone(symbols.size(), false) {
+        text.reserve(instructions * 128); // about what arithmetic takes
+        text += "# generated by the mini compiler; link with runtime/runtime.c\n";
+        text += "\t.text\n\t.globl main\n\t.type main, @function\nmain:\n";
+        cold = "# runtime errors and values that are not plain integers\n";
+    }
+
+    void section(bool c) override { cur = c ? &cold : &text; }
+    Label label() override { return labels++; }
+    void bind(Label l) override { put(l), *cur += ":\n"; }
+    void comment(const std::string& c) override { *cur += "\t# ", *cur += c, *cur += '\n'; }
+
+    void movq(X86Arg dst, X86Arg src) override {
+        bool address = src.kind == X86Arg::Str || src.kind == X86Arg::Big || src.kind == X86Arg::Name;
+        ins(address ? "leaq" : src.kind == X86Arg::Imm && !fitsInt32(src.value) ? "movabsq" : "movq", src, dst);
+    }
+    void aluq(Alu op, X86Reg dst, X86Arg src) override {
+        static const char* const MNEMONICS[] = {"movq", "addq", "subq", "imulq", "andq", "orq"};
+        *cur += '\t', *cur += MNEMONICS[static_cast<int>(op)], *cur += ' ';
+        put(src);
+        if (op == Alu::Imul && !src.isReg()) *cur += ", ", put(dst);
+        *cur += ", ", put(dst), *cur += '\n';
+    }
+    void testq(X86Reg a, X86Reg b) override { ins("testq", b, a); }
+    void testLowBit(X86Reg r) override { *cur += "\ttestb $1, ", *cur += NAMES8[static_cast<int>(r)], *cur += '\n'; }
+    void cmpq(X86Reg r, int32_t imm) override { ins("cmpq", X86Arg{X86Arg::Imm, imm}, r); }
+    void sarq1(X86Reg r) override { *cur += "\tsarq $1, ", put(r), *cur += '\n'; }
+    void cqto() override { *cur += "\tcqto\n"; }
+    void idivq(X86Reg r) override { ins("idivq", r); }
+    void tag(X86Reg r) override { *cur += "\tleaq 1(", put(r), *cur += ',', put(r), *cur += "), ", put(r), *cur += '\n'; }
+    void jmp(Label l) override { ins("jmp", l); }
+    void jz(Label l) override { ins("jz", l); }
+    void jo(Label l) override { ins("jo", l); }
+    void call(Helper h) override { *cur += "\tcall ", *cur += HELPERS[static_cast<int>(h)], *cur += '\n'; }
+    void pushq(X86Reg r) override { ins("pushq", r); }
+    void popq(X86Reg r) override { ins("popq", r); }
+    void addRsp(int32_t bytes) override {
+        if (bytes < 0) ins("subq", X86Arg{X86Arg::Imm, -int64_t(bytes)}, X86Reg::RSP);
+        else ins("addq", X86Arg{X86Arg::Imm, bytes}, X86Reg::RSP);
+    }
+    void ret() override { *cur += "\tret\n"; }
+
+    // The whole file, once the program is lowered.
+    std::string finish(const std::vector<Symbol>& vars) {
+        std::string out = std::move(text);
+        out += cold;
+        out += "\t.size main, .-main\n";
+        out += "\t.section .rodata\n";
+        for (size_t v = 0; v < vars.size(); ++v) {
+            out += ".Ln" + std::to_string(v) + ":\n\t.asciz " + quoted(symbols.name(vars[v])) + "\n";
+        }
+        out += "\t.data\n" + data;
+        out += "\t.bss\n\t.p2align 3\n.Lvars:\n\t.zero " + std::to_string(std::max<size_t>(vars.size(), 1) * 8) + "\n";
+        out += "\t.section .note.GNU-stack,\"\",@progbits\n";
+        return out;
+    }
+};
+
+}
+
+X86CodeGenerator::X86CodeGenerator(int registers) : registers(std::min(registers, REGISTERS)) {}
+
+std::string X86CodeGenerator::generate(const IRProgram& ir, const SymbolTable& symbols) {
+    RegisterAllocation ra = RegisterAllocation::build(ir, registers, 0);
+    lastStats = ra.stats;
+    TextEmitter out(symbols, ir.code.size());
+    std::vector<Symbol> vars = lowerToX86(ir, ra, out);
+    return out.finish(vars);
+}
+
+bool buildExecutable(const std::string& assembly, const std::string& runtime, const std::string& output,
+                     std::string& error) {
+    std::string asmPath = output + ".s";
+    {
+        std::ofstream file(asmPath, std::ios::binary);
+        file << assembly;
+        if (!file) {
+            error = "cannot write " + asmPath;
+            return false;
+        }
+    }
+    std::ifstream check(runtime);
+    if (!check) {
+        error = "runtime source not found: " + runtime + " (see --runtime)";
+        return false;
+    }
+
+    const char* cc = std::getenv("CC");
+    std::string command = std::string(cc && *cc ? cc : "cc") + " -O2 -o " + shellQuote(output) + " " +
+                          shellQuote(asmPath) + " " + shellQuote(runtime);
+    int status = std::system(command.c_str());
+    if (status != 0) {
+        error = "assembling and linking failed: " + command;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#!/bin/sh
+# Differential test of the execution engines: every program in tests/ is
+# run by the AST interpreter and, with the same input, by the IR executor
+# (--run-ir), the JIT (--jit) and a native executable (--native) at each
+# optimization level, and their stdout and stderr must be identical. A
+# native executable prints only what the program does, so it is compared
+# with the "Running Program" part of the interpreter's stdout and the
+# runtime errors on its stderr. The JIT and native code need x86-64, and
+# native code a C compiler ($CC, or cc); without them they are skipped.
+#
+#   tests/diff_engines.sh [COMPILER] [-O0 -O1 -O2 ...] [OPTION ...]
+#
+# COMPILER defaults to ./compiler; run it from the repository root. Any
+# other OPTION is passed to every run: with `--registers 2` nearly every
+# temp of tests/test9.txt is spilled, in the listing and in the JIT's and
+# native code's registers alike. A program reads tests/NAME.in if there is
+# one, and an empty input otherwise.
+
+compiler=${1:-./compiler}
+[ $# -gt 0 ] && shift
+levels=
+options=
+for arg in "$@"; do
+    case $arg in
+        -O*) levels="$levels $arg" ;;
+        *) options="$options $arg" ;;
+    esac
+done
+levels=${levels:--O0 -O1 -O2}
+
+dir=$(dirname "$0")
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+engines="--run-ir"
+native=no
+if [ "$(uname -m)" = x86_64 ]; then
+    engines="$engines --jit"
+    command -v "${CC:-cc}" > /dev/null 2>&1 && native=yes
+fi
+
+failed=0
+count=0
+
+# compare: LABEL, then the expected and actual stdout and stderr files
+compare() {
+    count=$((count + 1))
+    if ! cmp -s "$2" "$4" || ! cmp -s "$3" "$5"; then
+        echo "DIFFERS: $1"
+        diff "$2" "$4" | head -n 10
+        diff "$3" "$5" | head -n 10
+        failed=$((failed + 1))
+    fi
+}
+
+for file in "$dir"/*.txt; do
+    input="${file%.txt}.in"
+    [ -f "$input" ] || input=/dev/null
+    for level in $levels; do
+        "$compiler" "$level" $options "$file" < "$input" > "$work/ast.out" 2> "$work/ast.err"
+        for engine in $engines; do
+            "$compiler" "$level" $options "$engine" "$file" < "$input" > "$work/run.out" 2> "$work/run.err"
+            compare "$file $level $engine" "$work/ast.out" "$work/ast.err" "$work/run.out" "$work/run.err"
+        done
+
+        # a program rejected by the compiler has nothing to run
+        [ "$native" = yes ] && grep -q '^=== Running Program ===$' "$work/ast.out" || continue
+        sed '1,/^=== Running Program ===$/d' "$work/ast.out" > "$work/program.out"
+        grep '^Runtime error' "$work/ast.err" > "$work/program.err"
+        if ! "$compiler" "$level" $options --native "$work/native" --runtime "$dir/../runtime/runtime.c" "$file" \
+                < /dev/null > /dev/null 2> "$work/build.err" || [ ! -x "$work/native" ]; then
+            count=$((count + 1))
+            echo "DIFFERS: $file $level --native (not built)"
+            head -n 10 "$work/build.err"
+            failed=$((failed + 1))
+            continue
+        fi
+        "$work/native" < "$input" > "$work/run.out" 2> "$work/run.err"
+        compare "$file $level --native" "$work/program.out" "$work/program.err" "$work/run.out" "$work/run.err"
+        rm -f "$work/native"
+    done
+done
+
+echo "$count runs, $failed differ"
+[ "$failed" -eq 0 ]
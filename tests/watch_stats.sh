@@ -0,0 +1,45 @@
+#!/bin/sh
+# Check of --watch's statistics: a file of N statements, followed by blank
+# lines and a comment, must report N statements, all of them rebuilt at
+# first; appending one statement must then rebuild that one alone.
+#
+#   tests/watch_stats.sh [COMPILER]
+#
+# COMPILER defaults to ./compiler.
+
+compiler=${1:-./compiler}
+work=$(mktemp -d) || exit 1
+pid=
+trap '[ -n "$pid" ] && kill "$pid" 2> /dev/null; rm -rf "$work"' EXIT
+
+failed=0
+
+# expect: the number of [watch] lines to wait for, and what the last one says
+expect() {
+    tries=0
+    while [ "$(grep -c '^\[watch\]' "$work/out")" -lt "$1" ] && [ $tries -lt 50 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+    got=$(grep '^\[watch\]' "$work/out" | sed -n "$1p")
+    case $got in
+        *": $2, "*) ;;
+        *)
+            echo "DIFFERS: expected \"$2\", got \"$got\""
+            failed=$((failed + 1))
+            ;;
+    esac
+}
+
+printf 'a = 1;\nb = a + "; not a boundary";\ncout(b); /* ; */\n\n// done;\n\n' > "$work/watched.txt"
+"$compiler" --watch "$work/watched.txt" > "$work/out" 2> "$work/err" &
+pid=$!
+expect 1 "3 statements, 3 rebuilt"
+
+# the mode polls the size and modification time every 200 ms
+sleep 0.3
+printf 'cout(a);\n// done\n' >> "$work/watched.txt"
+expect 2 "4 statements, 1 rebuilt"
+
+[ "$failed" -eq 0 ] && echo "watch statistics match"
+[ "$failed" -eq 0 ]